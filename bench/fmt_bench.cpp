@@ -0,0 +1,119 @@
+//===---------------------------------------------------------===
+//
+// Micro benchmark comparing the OutStream number formatting
+// against snprintf and std::to_chars.
+//
+// Build with -DSSC_BUILD_BENCHMARKS=ON in release mode.
+//
+//===---------------------------------------------------------===
+#include "fmt.h"
+
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Discards the output but keeps the formatting from being
+// optimized away.
+class SinkStream : public ssc::OutStream {
+public:
+    ulen checksum=0;
+protected:
+    void flush_buffer(const char* buf, ulen size) override {
+        checksum += size + (u8) buf[0];
+    }
+};
+
+volatile ulen SINK;
+
+template<typename F>
+void run(const char* name, ulen count, F&& func) {
+    auto start=std::chrono::steady_clock::now();
+    func();
+    auto end=std::chrono::steady_clock::now();
+    double ns=(double) std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count();
+    ssc::println("  %-24s %s ns/op", name, ns / count);
+}
+
+template<typename T, typename W>
+void bench_values(const char* title, const std::vector<T>& values,
+                  const char* printf_fmt, W&& write_stream) {
+    ssc::println("%s", title);
+    char buf[64];
+    run("OutStream", values.size(), [&] {
+        SinkStream stream;
+        for (T v : values)
+            write_stream(stream, v);
+        SINK = stream.checksum;
+    });
+    run("snprintf", values.size(), [&] {
+        ulen checksum=0;
+        for (T v : values)
+            checksum += snprintf(buf, sizeof(buf), printf_fmt, v);
+        SINK = checksum;
+    });
+    run("std::to_chars", values.size(), [&] {
+        ulen checksum=0;
+        for (T v : values) {
+            char* end;
+            if constexpr (std::is_integral_v<T>)
+                end=std::to_chars(buf, buf+sizeof(buf), v, 10).ptr;
+            else
+                end=std::to_chars(buf, buf+sizeof(buf), v).ptr;
+            checksum += end-buf;
+        }
+        SINK = checksum;
+    });
+}
+
+}
+
+int main() {
+    const ulen COUNT=2'000'000;
+    std::mt19937_64 rng(42);
+
+    std::vector<unsigned long long> small, large;
+    std::vector<long long> signed_vals;
+    std::vector<double> doubles;
+    for (ulen i=0; i<COUNT; i++) {
+        small.push_back(rng() % 1000);
+        large.push_back(rng() >> (rng() % 64));
+        signed_vals.push_back((long long) (rng() >> (rng() % 64)));
+        doubles.push_back(std::uniform_real_distribution<double>(-1e6, 1e6)(rng));
+    }
+
+    bench_values("u64 small decimal", small, "%llu",
+                 [](ssc::OutStream& s, unsigned long long v) { s.write((u64) v); });
+    bench_values("u64 decimal", large, "%llu",
+                 [](ssc::OutStream& s, unsigned long long v) { s.write((u64) v); });
+    bench_values("i64 decimal", signed_vals, "%lld",
+                 [](ssc::OutStream& s, long long v) { s.write((i64) v); });
+    bench_values("double shortest", doubles, "%.17g",
+                 [](ssc::OutStream& s, double v) { s.write(v); });
+
+    ssc::println("u64 hex");
+    run("OutStream", COUNT, [&] {
+        SinkStream stream;
+        for (unsigned long long v : large)
+            stream.write((u64) v, 16, true);
+        SINK = stream.checksum;
+    });
+    run("snprintf", COUNT, [&] {
+        char buf[64];
+        ulen checksum=0;
+        for (unsigned long long v : large)
+            checksum += snprintf(buf, sizeof(buf), "%llx", v);
+        SINK = checksum;
+    });
+    run("std::to_chars", COUNT, [&] {
+        char buf[64];
+        ulen checksum=0;
+        for (unsigned long long v : large)
+            checksum += std::to_chars(buf, buf+sizeof(buf), v, 16).ptr-buf;
+        SINK = checksum;
+    });
+}
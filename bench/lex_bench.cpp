@@ -0,0 +1,143 @@
+//===---------------------------------------------------------===
+//
+// Benchmark of the lexer's throughput over a generated source,
+// checked against LEX_TARGET_MB_PER_S.
+//
+// Build with -DSSC_BUILD_BENCHMARKS=ON in release mode. The
+// size of the source in megabytes can be given as the first
+// argument.
+//
+//===---------------------------------------------------------===
+#include "fmt.h"
+#include "lexer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+// Lexing a source should take a small part of compiling it,
+// so the lexer has to keep up with reading from the page cache.
+constexpr double LEX_TARGET_MB_PER_S=200.0;
+
+constexpr int RUNS=5;
+
+const char* const NAMES[]={
+    "i", "n", "count", "buffer", "node", "result", "value", "index",
+    "parse_expression", "SourceManager", "tokens", "x", "y", "size",
+};
+
+const char* const TYPES[]={ "u8", "u32", "i64", "f64", "bool", "Node", "List" };
+
+// Builds functions of the kind of code a compiler sees, with
+// a mix of keywords, identifiers, literals, operators and
+// comments.
+std::string generate_source(ulen size) {
+    std::mt19937_64 rng(42);
+    auto pick=[&](const auto& words) {
+        return words[rng() % (sizeof(words)/sizeof(words[0]))];
+    };
+
+    std::string src;
+    src.reserve(size + 1024);
+    ulen id=0;
+    while (src.size() < size) {
+        src += "// Function number " + std::to_string(id) + " of the generated source.\n";
+        src += "pub fn ";
+        src += pick(NAMES);
+        src += "_" + std::to_string(id++) + "(a: " + pick(TYPES) + ", b: &" + pick(TYPES) + ") -> ";
+        src += pick(TYPES);
+        src += " {\n";
+        ulen statements=4 + rng() % 8;
+        for (ulen i=0; i < statements; ++i) {
+            switch (rng() % 6) {
+                case 0:
+                    src += "    let ";
+                    src += pick(NAMES);
+                    src += ": " + std::string(pick(TYPES)) + " = " + std::to_string(rng() % 100000) + ";\n";
+                    break;
+                case 1:
+                    src += "    var ";
+                    src += pick(NAMES);
+                    src += " = ";
+                    src += pick(NAMES);
+                    src += " * 3.25e-2 + (b.size << 2);\n";
+                    break;
+                case 2:
+                    src += "    if ";
+                    src += pick(NAMES);
+                    src += " >= 0x1F && !";
+                    src += pick(NAMES);
+                    src += " {\n        return \"unexpected \\\"token\\\" in input\";\n    }\n";
+                    break;
+                case 3:
+                    src += "    for i in 0..";
+                    src += pick(NAMES);
+                    src += ".size {\n        ";
+                    src += pick(NAMES);
+                    src += "[i] += 'x';\n    }\n";
+                    break;
+                case 4:
+                    src += "    /* Folded when both sides are constants. */\n    ";
+                    src += pick(NAMES);
+                    src += " = ";
+                    src += pick(NAMES);
+                    src += "::";
+                    src += pick(NAMES);
+                    src += "(a, b) | 0b1010;\n";
+                    break;
+                default:
+                    src += "    while ";
+                    src += pick(NAMES);
+                    src += " != null { break; }\n";
+                    break;
+            }
+        }
+        src += "    return a;\n}\n\n";
+    }
+    return src;
+}
+
+volatile ulen SINK;
+
+}
+
+int main(int argc, char** argv) {
+    ulen megabytes=argc > 1 ? (ulen) strtoul(argv[1], nullptr, 10) : 64;
+    if (megabytes == 0)
+        megabytes=64;
+
+    ssc::SourceManager sources;
+    std::string text=generate_source(megabytes << 20);
+    const ssc::SourceFile* file=sources.add_buffer(ssc::StrSlice("generated.ss", 12),
+                                                   ssc::StrSlice(text.data(), text.size()));
+    text.clear();
+    text.shrink_to_fit();
+
+    double mb=(double) file->size / (1 << 20);
+    double best=0;
+    ulen token_count=0;
+    ssc::println("lexing %s MiB", mb);
+    for (int run=0; run < RUNS; ++run) {
+        ssc::StringInterner interner;
+        ssc::Tokens tokens;
+        auto start=std::chrono::steady_clock::now();
+        ulen errors=ssc::Lexer(*file, interner).lex(tokens);
+        auto end=std::chrono::steady_clock::now();
+        double s=(double) std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count() / 1e9;
+        double rate=mb / s;
+        if (rate > best)
+            best=rate;
+        token_count=tokens.size();
+        SINK = errors + tokens.size();
+        ssc::println("  run %-20s %s MB/s", run, rate);
+    }
+
+    ssc::println("  %-24s %s", "tokens", token_count);
+    ssc::println("  %-24s %s MB/s", "best", best);
+    ssc::println("  %-24s %s MB/s (%s)", "target", LEX_TARGET_MB_PER_S,
+                 best >= LEX_TARGET_MB_PER_S ? "met" : "missed");
+    return best >= LEX_TARGET_MB_PER_S ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include "characters.h"
+#include "simd.h"
+
+#include <bit> // for std::countr_zero
+
+#if SSC_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace ssc {
+
+#if SSC_SIMD_X86
+
+  // Each kernel gets a mask with a bit set for every byte of the
+  // block at which the scan should stop.
+
+static inline __m128i in_range_sse2(__m128i v, char lo, char hi) {
+    __m128i ge=_mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(lo)), v);
+    __m128i le=_mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(hi)), v);
+    return _mm_and_si128(ge, le);
+}
+
+static inline u32 stop_whitespace_sse2(__m128i v) {
+    __m128i ws=_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                            in_range_sse2(v, '\t', '\r'));
+    return ~(u32) _mm_movemask_epi8(ws) & 0xffff;
+}
+
+static inline u32 stop_ident_sse2(__m128i v) {
+    __m128i lower=_mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i ident=_mm_or_si128(in_range_sse2(lower, 'a', 'z'),
+                               in_range_sse2(v, '0', '9'));
+    ident=_mm_or_si128(ident, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    // Bytes of UTF-8 sequences have their top bit set.
+    u32 mask=(u32) _mm_movemask_epi8(ident) | (u32) _mm_movemask_epi8(v);
+    return ~mask & 0xffff;
+}
+
+static inline u32 stop_newline_sse2(__m128i v) {
+    return (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+}
+
+static inline u32 stop_quote_sse2(__m128i v, char quote) {
+    __m128i stop=_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)),
+                              _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    stop=_mm_or_si128(stop, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    return (u32) _mm_movemask_epi8(stop);
+}
+
+SSC_TARGET_AVX2 static inline __m256i in_range_avx2(__m256i v, char lo, char hi) {
+    __m256i ge=_mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(lo)), v);
+    __m256i le=_mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(hi)), v);
+    return _mm256_and_si256(ge, le);
+}
+
+SSC_TARGET_AVX2 static inline u32 stop_whitespace_avx2(__m256i v) {
+    __m256i ws=_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                               in_range_avx2(v, '\t', '\r'));
+    return ~(u32) _mm256_movemask_epi8(ws);
+}
+
+SSC_TARGET_AVX2 static inline u32 stop_ident_avx2(__m256i v) {
+    __m256i lower=_mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i ident=_mm256_or_si256(in_range_avx2(lower, 'a', 'z'),
+                                  in_range_avx2(v, '0', '9'));
+    ident=_mm256_or_si256(ident, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    u32 mask=(u32) _mm256_movemask_epi8(ident) | (u32) _mm256_movemask_epi8(v);
+    return ~mask;
+}
+
+SSC_TARGET_AVX2 static inline u32 stop_newline_avx2(__m256i v) {
+    return (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+}
+
+SSC_TARGET_AVX2 static inline u32 stop_quote_avx2(__m256i v, char quote) {
+    __m256i stop=_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)),
+                                 _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    stop=_mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    return (u32) _mm256_movemask_epi8(stop);
+}
+
+  // Stamps out the SSE2 and AVX2 loops of a scanner, the bytes
+  // left over after the last whole block are checked with
+  // `scalar_stop`.
+#define SSC_DEFINE_SCANNER(name, stop_sse2, stop_avx2, scalar_stop, ...)   \
+    static const char* name##_sse2(const char* p, const char* end          \
+                                   __VA_OPT__(, char arg)) {                \
+        for (; end-p >= 16; p += 16) {                                      \
+            __m128i v=_mm_loadu_si128((const __m128i*) p);                  \
+            if (u32 mask=stop_sse2(v __VA_OPT__(, arg)))                    \
+                return p + std::countr_zero(mask);                          \
+        }                                                                   \
+        for (; p != end && !(scalar_stop); ++p);                            \
+        return p;                                                           \
+    }                                                                       \
+    SSC_TARGET_AVX2 static const char* name##_avx2(const char* p,          \
+                                                   const char* end          \
+                                                   __VA_OPT__(, char arg)) {\
+        for (; end-p >= 32; p += 32) {                                      \
+            __m256i v=_mm256_loadu_si256((const __m256i*) p);               \
+            if (u32 mask=stop_avx2(v __VA_OPT__(, arg)))                    \
+                return p + std::countr_zero(mask);                          \
+        }                                                                   \
+        for (; p != end && !(scalar_stop); ++p);                            \
+        return p;                                                           \
+    }
+
+SSC_DEFINE_SCANNER(skip_whitespace, stop_whitespace_sse2, stop_whitespace_avx2,
+                   !is_whitespace(*p))
+SSC_DEFINE_SCANNER(find_ident_end, stop_ident_sse2, stop_ident_avx2,
+                   !is_ident_cont(*p))
+SSC_DEFINE_SCANNER(find_newline, stop_newline_sse2, stop_newline_avx2,
+                   *p == '\n')
+SSC_DEFINE_SCANNER(find_quote_or_newline, stop_quote_sse2, stop_quote_avx2,
+                   *p == arg || *p == '\\' || *p == '\n', arg)
+
+#undef SSC_DEFINE_SCANNER
+
+const char* skip_whitespace(const char* p, const char* end) {
+    if (cpu_has_avx2())
+        return skip_whitespace_avx2(p, end);
+    return skip_whitespace_sse2(p, end);
+}
+
+const char* find_ident_end(const char* p, const char* end) {
+    if (cpu_has_avx2())
+        return find_ident_end_avx2(p, end);
+    return find_ident_end_sse2(p, end);
+}
+
+const char* find_newline(const char* p, const char* end) {
+    if (cpu_has_avx2())
+        return find_newline_avx2(p, end);
+    return find_newline_sse2(p, end);
+}
+
+const char* find_quote_or_newline(const char* p, const char* end, char quote) {
+    if (cpu_has_avx2())
+        return find_quote_or_newline_avx2(p, end, quote);
+    return find_quote_or_newline_sse2(p, end, quote);
+}
+
+#else
+
+const char* skip_whitespace(const char* p, const char* end) {
+    while (p != end && is_whitespace(*p))
+        ++p;
+    return p;
+}
+
+const char* find_ident_end(const char* p, const char* end) {
+    while (p != end && is_ident_cont(*p))
+        ++p;
+    return p;
+}
+
+const char* find_newline(const char* p, const char* end) {
+    while (p != end && *p != '\n')
+        ++p;
+    return p;
+}
+
+const char* find_quote_or_newline(const char* p, const char* end, char quote) {
+    while (p != end && *p != quote && *p != '\\' && *p != '\n')
+        ++p;
+    return p;
+}
+
+#endif
+}
@@ -1,12 +1,110 @@
 #ifndef SSC_CHARACTERS_H
 #define SSC_CHARACTERS_H
 
+#include <array>
+#include "core_types.h"
+
 namespace ssc {
 
-inline bool is_digit(char c) {
-    return c>=48 && c<=57;
+/// The classes a byte of source can belong to, as bits
+/// of the entries of CHAR_CLASSES.
+///
+enum CharClass : u8 {
+    CHAR_DIGIT       = 1 << 0,
+    CHAR_HEX_DIGIT   = 1 << 1,
+      // Bytes of UTF-8 sequences are allowed in identifiers.
+    CHAR_IDENT_START = 1 << 2,
+    CHAR_IDENT_CONT  = 1 << 3,
+      // Whitespace other than a new line.
+    CHAR_SPACE       = 1 << 4,
+    CHAR_NEWLINE     = 1 << 5,
+    CHAR_OPERATOR    = 1 << 6,
+};
+
+constexpr std::array<u8, 256> make_char_classes() {
+    std::array<u8, 256> classes{};
+    for (int c='0'; c <= '9'; ++c)
+        classes[c] |= CHAR_DIGIT | CHAR_HEX_DIGIT | CHAR_IDENT_CONT;
+    for (int c='a'; c <= 'f'; ++c)
+        classes[c] |= CHAR_HEX_DIGIT, classes[c-'a'+'A'] |= CHAR_HEX_DIGIT;
+    for (int c='a'; c <= 'z'; ++c) {
+        classes[c]         |= CHAR_IDENT_START | CHAR_IDENT_CONT;
+        classes[c-'a'+'A'] |= CHAR_IDENT_START | CHAR_IDENT_CONT;
+    }
+    for (int c=0x80; c <= 0xff; ++c)
+        classes[c] |= CHAR_IDENT_START | CHAR_IDENT_CONT;
+    classes['_'] |= CHAR_IDENT_START | CHAR_IDENT_CONT;
+    for (char c : { ' ', '\t', '\r', '\v', '\f' })
+        classes[(u8) c] |= CHAR_SPACE;
+    classes['\n'] |= CHAR_NEWLINE;
+    for (char c : { '!', '#', '$', '%', '&', '(', ')', '*', '+', ',', '-', '.',
+                    '/', ':', ';', '<', '=', '>', '?', '@', '[', ']', '^', '{',
+                    '|', '}', '~' })
+        classes[(u8) c] |= CHAR_OPERATOR;
+    return classes;
+}
+
+/// The classes of every byte, looked up instead of comparing
+/// against ranges so classifying a byte never branches.
+///
+inline constexpr std::array<u8, 256> CHAR_CLASSES=make_char_classes();
+
+constexpr bool is_char_class(char c, u8 classes) {
+    return (CHAR_CLASSES[(u8) c] & classes) != 0;
+}
+
+constexpr bool is_digit(char c) {
+    return is_char_class(c, CHAR_DIGIT);
+}
+
+constexpr bool is_hex_digit(char c) {
+    return is_char_class(c, CHAR_HEX_DIGIT);
+}
+
+constexpr bool is_ident_start(char c) {
+    return is_char_class(c, CHAR_IDENT_START);
+}
+
+constexpr bool is_ident_cont(char c) {
+    return is_char_class(c, CHAR_IDENT_CONT);
 }
 
+constexpr bool is_space(char c) {
+    return is_char_class(c, CHAR_SPACE);
+}
+
+constexpr bool is_newline(char c) {
+    return is_char_class(c, CHAR_NEWLINE);
+}
+
+constexpr bool is_whitespace(char c) {
+    return is_char_class(c, CHAR_SPACE | CHAR_NEWLINE);
+}
+
+constexpr bool is_operator(char c) {
+    return is_char_class(c, CHAR_OPERATOR);
+}
+
+  // The scanners below check 16 or 32 bytes at a time with SSE2
+  // or AVX2, whichever the processor supports, and return `end`
+  // if they reach it.
+
+/// Get the first byte which is not whitespace, new lines included.
+///
+const char* skip_whitespace(const char* p, const char* end);
+
+/// Get the first byte which cannot continue an identifier.
+///
+const char* find_ident_end(const char* p, const char* end);
+
+/// Get the first new line.
+///
+const char* find_newline(const char* p, const char* end);
+
+/// Get the first `quote`, backslash or new line, which are the
+/// bytes that end a run of plain characters in a string literal.
+///
+const char* find_quote_or_newline(const char* p, const char* end, char quote);
 }
 
 #endif
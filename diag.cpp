@@ -0,0 +1,86 @@
+#include "diag.h"
+
+#include <cstring>   // for memcpy
+#include <cstdlib>   // for malloc, free
+#include <algorithm> // for std::sort
+
+#include "fmt.h"
+
+// Satisfying linkage
+//
+namespace ssc {
+DiagQueue diag_queue;
+}
+
+ssc::DiagQueue::~DiagQueue() {
+    DiagMessage* msg=head.exchange(nullptr);
+    while (msg) {
+        DiagMessage* next=msg->next;
+        std::free(msg);
+        msg = next;
+    }
+}
+
+void ssc::DiagQueue::push(DiagMessage* msg) {
+    msg->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(msg->next, msg,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed));
+}
+
+void ssc::DiagQueue::drain(OutStream& out) {
+    DiagMessage* msg=head.exchange(nullptr, std::memory_order_acquire);
+    if (!msg)
+        return;
+
+    // No two messages share a key, stream and sequence number so
+    // the order in which they were pushed does not matter.
+    List<DiagMessage*> msgs;
+    for (; msg; msg = msg->next)
+        msgs.add(msg);
+    std::sort(msgs.begin(), msgs.end(),
+        [](const DiagMessage* lhs, const DiagMessage* rhs) {
+            if (lhs->key != rhs->key)
+                return lhs->key < rhs->key;
+            if (lhs->stream != rhs->stream)
+                return lhs->stream < rhs->stream;
+            return lhs->seq < rhs->seq;
+        });
+
+    for (DiagMessage* m : msgs) {
+        OutPart part { m->text(), m->size };
+        out.write_parts(&part, 1);
+        std::free(m);
+    }
+}
+
+ssc::DiagStream::~DiagStream() {
+    commit();
+}
+
+void ssc::DiagStream::commit() {
+    if (empty())
+        return;
+    DiagMessage* msg=(DiagMessage*) std::malloc(sizeof(DiagMessage) + size());
+    if (!msg)
+        panic("Out of memory");
+    msg->key    = order_key;
+    msg->stream = stream_id;
+    msg->seq    = next_seq++;
+    msg->size   = size();
+    memcpy(msg + 1, data(), size());
+    queue.push(msg);
+    clear();
+}
+
+ssc::DiagStream& ssc::diag_stream() {
+    // Whatever is still pending at exit gets written out.
+    [[maybe_unused]] static bool registered=(std::atexit(flush_diagnostics), true);
+    thread_local DiagStream stream { diag_queue };
+    return stream;
+}
+
+void ssc::flush_diagnostics() {
+    diag_queue.drain(stderr_stream);
+    stderr_stream.flush();
+}
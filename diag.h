@@ -0,0 +1,142 @@
+//===---------------------------------------------------------===
+//
+// Diagnostic output which is safe to produce from multiple
+// threads at once.
+//
+// Each thread formats into its own DiagStream and commits whole
+// messages to a lock-free DiagQueue. A single writer drains the
+// queue ordered by the key each message was committed under and
+// then by stream, so the output does not depend on how work was
+// spread across threads.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_DIAG_H
+#define SSC_DIAG_H
+
+#include <atomic>
+
+#include "strstream.h"
+
+namespace ssc {
+
+/// A committed message. The text is stored right after
+/// the message.
+///
+struct DiagMessage {
+    DiagMessage* next;
+    u64  key;
+    u64  stream;
+    u64  seq;
+    ulen size;
+
+    const char* text() const { return (const char*) (this + 1); }
+};
+
+/// A lock-free queue of committed messages which any number
+/// of threads may push to.
+///
+class DiagQueue {
+public:
+
+    DiagQueue() = default;
+
+    DiagQueue(const DiagQueue&) = delete;
+    DiagQueue& operator=(const DiagQueue&) = delete;
+
+    ~DiagQueue();
+
+    /// Publishes a message allocated with std::malloc. The
+    /// queue takes ownership of the message.
+    ///
+    void push(DiagMessage* msg);
+
+    /// Writes every published message to `out` ordered by key,
+    /// messages with the same key by the stream they came from
+    /// and those of one stream in the order they were committed.
+    ///
+    /// Only one thread may drain at a time.
+    ///
+    void drain(OutStream& out);
+
+    /// Get an id for a new stream. Ids are handed out in
+    /// increasing order.
+    ///
+    u64 new_stream_id() { return next_stream_id.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    std::atomic<DiagMessage*> head { nullptr };
+    std::atomic<u64>          next_stream_id { 0 };
+};
+
+/// A stream which collects the diagnostics of a single thread.
+/// Nothing reaches the queue until commit() is called.
+///
+class DiagStream : public StringOutStream {
+public:
+
+    /// Creates a stream whose messages come after those of
+    /// streams with a lower id when their keys are equal. Giving
+    /// each stream an id tied to the work it does, rather than to
+    /// when it was created, keeps equal keys in a fixed order.
+    ///
+    DiagStream(DiagQueue& queue, u64 stream_id) :
+        queue(queue),
+        stream_id(stream_id)
+    {}
+
+    /// Creates a stream with the next id of the queue.
+    ///
+    DiagStream(DiagQueue& queue) :
+        DiagStream(queue, queue.new_stream_id())
+    {}
+
+    /// Commits whatever was not yet committed.
+    ///
+    ~DiagStream();
+
+    /// Sets the key that the following messages are ordered by,
+    /// such as the id of the task being worked on or the source
+    /// offset of the code being compiled.
+    ///
+    void set_order_key(u64 key) {
+        order_key = key;
+    }
+
+    u64 get_stream_id() const { return stream_id; }
+
+    /// Publishes everything written since the last commit as
+    /// one message.
+    ///
+    void commit();
+
+private:
+    DiagQueue& queue;
+    u64 stream_id;
+    u64 order_key=0;
+    u64 next_seq=0;
+};
+
+extern DiagQueue diag_queue;
+
+/// The calling thread's stream into diag_queue.
+///
+DiagStream& diag_stream();
+
+/// Writes the pending diagnostics of all threads to standard
+/// error and flushes it.
+///
+void flush_diagnostics();
+
+/// Writes a formatted line to the calling thread's diagnostic
+/// stream and commits it.
+///
+template<typename... TArgs>
+inline void diag_println(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
+    DiagStream& stream=diag_stream();
+    stream.writeln(fmt, std::forward<TArgs>(args)...);
+    stream.commit();
+}
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "filestream.h"
+
+#include <cstring>   // for memcpy, memset
+#include <algorithm> // for std::min
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+ssc::FileOutStream::~FileOutStream() {
+    close();
+}
+
+bool ssc::FileOutStream::open(const char* path, Mode mode) {
+    close();
+#ifdef _WIN32
+    HANDLE hdl=CreateFileA(path, GENERIC_WRITE, 0, nullptr,
+                           CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hdl == INVALID_HANDLE_VALUE)
+        return false;
+    file = hdl;
+    // Mapping is only implemented on POSIX systems.
+    mode = Mode::Buffered;
+#else
+    // Mapping a file for writing also requires read access.
+    int fd=::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    file = fd;
+#endif
+    opened        = true;
+    failed        = false;
+    written       = 0;
+    window_offset = 0;
+    window_pos    = 0;
+    this->mode    = mode;
+    if (mode == Mode::Mapped) {
+        set_buffer_size(0);
+        if (!map_next_window())
+            fallback_to_buffered();
+    } else
+        set_buffer_size(requested_buffer_size);
+    return true;
+}
+
+void ssc::FileOutStream::close() {
+    if (!opened)
+        return;
+    if (mode == Mode::Mapped) {
+        unmap_window();
+#ifndef _WIN32
+        // Removing the unused part of the last window.
+        if (ftruncate(file, written) != 0)
+            failed = true;
+#endif
+    } else
+        flush();
+#ifdef _WIN32
+    CloseHandle(file);
+#else
+    ::close(file);
+#endif
+    opened = false;
+}
+
+bool ssc::FileOutStream::map_next_window() {
+#ifdef _WIN32
+    return false;
+#else
+    ulen offset=window ? window_offset + MAP_WINDOW_SIZE : 0;
+    unmap_window();
+    // Growing the file so the whole window is backed by it.
+    if (ftruncate(file, offset + MAP_WINDOW_SIZE) != 0)
+        return false;
+    void* ptr=mmap(nullptr, MAP_WINDOW_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, file, (off_t) offset);
+    if (ptr == MAP_FAILED)
+        return false;
+    window        = (char*) ptr;
+    window_offset = offset;
+    window_pos    = 0;
+    return true;
+#endif
+}
+
+void ssc::FileOutStream::unmap_window() {
+#ifndef _WIN32
+    if (window)
+        munmap(window, MAP_WINDOW_SIZE);
+#endif
+    window = nullptr;
+}
+
+void ssc::FileOutStream::fallback_to_buffered() {
+    unmap_window();
+    mode = Mode::Buffered;
+    set_buffer_size(requested_buffer_size);
+#ifndef _WIN32
+    if (ftruncate(file, written) != 0 ||
+        lseek(file, (off_t) written, SEEK_SET) < 0)
+        failed = true;
+#endif
+}
+
+void ssc::FileOutStream::flush_buffer(const char* buf, ulen size) {
+    if (mode == Mode::Buffered) {
+        BufferedOutStream::flush_buffer(buf, size);
+        return;
+    }
+    while (size) {
+        if (window_pos == MAP_WINDOW_SIZE && !map_next_window()) {
+            fallback_to_buffered();
+            flush_buffer(buf, size);
+            return;
+        }
+        ulen count=std::min(size, MAP_WINDOW_SIZE - window_pos);
+        memcpy(window + window_pos, buf, count);
+        window_pos += count;
+        written    += count;
+        buf  += count;
+        size -= count;
+    }
+}
+
+void ssc::FileOutStream::flush_fill(char c, ulen n) {
+    if (mode == Mode::Buffered) {
+        BufferedOutStream::flush_fill(c, n);
+        return;
+    }
+    while (n) {
+        if (window_pos == MAP_WINDOW_SIZE && !map_next_window()) {
+            fallback_to_buffered();
+            flush_fill(c, n);
+            return;
+        }
+        ulen count=std::min(n, MAP_WINDOW_SIZE - window_pos);
+        memset(window + window_pos, c, count);
+        window_pos += count;
+        written    += count;
+        n -= count;
+    }
+}
+
+void ssc::FileOutStream::flush_parts(const OutPart* parts, ulen count) {
+    if (mode == Mode::Buffered) {
+        BufferedOutStream::flush_parts(parts, count);
+        return;
+    }
+    OutStream::flush_parts(parts, count);
+}
+
+void ssc::FileOutStream::write_out(const char* buf, ulen size,
+                                   const char* extra, ulen extra_size) {
+    written += size + extra_size;
+    if (!opened || failed)
+        return;
+    if (!write_all(file, buf, size, extra, extra_size))
+        failed = true;
+}
@@ -0,0 +1,101 @@
+//===---------------------------------------------------------===
+//
+// An output stream for writing files such as generated code
+// and IR dumps which may grow to many megabytes.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_FILESTREAM_H
+#define SSC_FILESTREAM_H
+
+#include "outstream.h"
+
+namespace ssc {
+
+/// A stream which writes to a file.
+///
+/// In buffered mode output is collected into a large buffer
+/// and written with as few system calls as possible.
+///
+/// In mapped mode the file is grown in large steps and output
+/// is copied straight into a memory mapped window of the file
+/// so that writing costs neither an extra copy nor a system
+/// call. When the file is closed it is truncated to the size
+/// of what was written. Mapped mode falls back to buffered
+/// mode where mapping is unavailable.
+///
+class FileOutStream : public BufferedOutStream {
+public:
+
+    enum class Mode {
+        Buffered,
+        Mapped
+    };
+
+    static constexpr ulen DEFAULT_BUFFER_SIZE=1 << 16;
+      // Must be a multiple of the page size.
+    static constexpr ulen MAP_WINDOW_SIZE=1 << 24;
+
+      // The buffer is only allocated once a file is written
+      // in buffered mode, mapped mode copies into the window.
+    FileOutStream(ulen buffer_size=DEFAULT_BUFFER_SIZE) :
+        BufferedOutStream(0),
+        requested_buffer_size(buffer_size)
+    {}
+
+    ~FileOutStream();
+
+    /// Creates or truncates the file at `path` for writing.
+    ///
+    /// \return false if the file could not be opened.
+    ///
+    bool open(const char* path, Mode mode=Mode::Buffered);
+
+    /// Writes out everything left and closes the file.
+    ///
+    void close();
+
+    bool is_open() const { return opened; }
+    Mode get_mode() const { return mode; }
+
+    /// Number of bytes written to the stream so far.
+    ///
+    ulen size() const { return written + buffered_size(); }
+
+    /// False once the operating system reported a failure to
+    /// write to the file.
+    ///
+    bool good() const { return !failed; }
+
+protected:
+    void flush_buffer(const char* buf, ulen size) override;
+    void flush_fill(char c, ulen n) override;
+    void flush_parts(const OutPart* parts, ulen count) override;
+
+    void write_out(const char* buf, ulen size,
+                   const char* extra, ulen extra_size) override;
+
+private:
+      // Moves the window to the next part of the file.
+    bool map_next_window();
+    void unmap_window();
+      // Leaves mapped mode and continues from the end of what
+      // was written to the window using buffered mode.
+    void fallback_to_buffered();
+
+    FileHandle file;
+    ulen  requested_buffer_size; // for buffered mode
+    bool  opened=false;
+    bool  failed=false;
+    Mode  mode=Mode::Buffered;
+    ulen  written=0; // excludes what is still buffered
+
+      // No window is mapped before the first one, which
+      // is at offset 0.
+    char* window=nullptr;
+    ulen  window_offset=0; // file offset of the window
+    ulen  window_pos=0;
+};
+
+}
+
+#endif
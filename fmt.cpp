@@ -2,6 +2,8 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#else
+#include <unistd.h>
 #endif
 
 // Satisfying linkage
@@ -11,20 +13,61 @@ PrintStream stdout_stream { PrintStream::Catagory::Stdout };
 PrintStream stderr_stream { PrintStream::Catagory::Stderr };
 }
 
+#ifdef _WIN32
+static HANDLE get_std_handle(ssc::PrintStream::Catagory catagory) {
+    return GetStdHandle(catagory == ssc::PrintStream::Catagory::Stdout
+                        ? STD_OUTPUT_HANDLE
+                        : STD_ERROR_HANDLE
+                       );
+}
+#else
+static int get_std_fd(ssc::PrintStream::Catagory catagory) {
+    return catagory == ssc::PrintStream::Catagory::Stdout
+           ? STDOUT_FILENO
+           : STDERR_FILENO;
+}
+#endif
+
+static bool is_terminal(ssc::PrintStream::Catagory catagory) {
+#ifdef _WIN32
+    return GetFileType(get_std_handle(catagory)) == FILE_TYPE_CHAR;
+#else
+    return isatty(get_std_fd(catagory));
+#endif
+}
+
 void ssc::set_terminal_color(TermColor color) {
 #ifdef _WIN32
+    // The color applies to whatever is written after this point
+    // so the buffered output has to be written first.
+    stdout_stream.flush();
     SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), (WORD) color);
 #endif
 }
 
-void ssc::PrintStream::flush_buffer(const char* buf, ulen size) {
+void ssc::flush_std_streams() {
+    stdout_stream.flush();
+    stderr_stream.flush();
+}
+
+ssc::PrintStream::PrintStream(Catagory catagory, ulen buffer_size) :
+    BufferedOutStream(buffer_size,
+                      catagory == Catagory::Stderr || is_terminal(catagory)
+                      ? BufferMode::Line : BufferMode::Full),
+    catagory(catagory)
+{}
+
+ssc::PrintStream::~PrintStream() {
+    // Leaves the stream unbuffered so that anything written
+    // during the remainder of static destruction still appears.
+    set_buffer_size(0);
+}
+
+void ssc::PrintStream::write_out(const char* buf, ulen size,
+                                 const char* extra, ulen extra_size) {
 #ifdef _WIN32
-        HANDLE hdl=GetStdHandle(catagory == Catagory::Stdout
-                                ? STD_OUTPUT_HANDLE
-                                : STD_ERROR_HANDLE
-                               );
-        DWORD written;
-        WriteFile(hdl, buf, (DWORD) size, &written, nullptr);
+    write_all(get_std_handle(catagory), buf, size, extra, extra_size);
+#else
+    write_all(get_std_fd(catagory), buf, size, extra, extra_size);
 #endif
 }
-
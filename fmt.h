@@ -15,23 +15,38 @@
 
 namespace ssc {
 
-class PrintStream : public OutStream {
+/// A buffered stream to either standard output or standard
+/// error.
+///
+/// Standard output is line buffered when attached to a terminal
+/// and standard error is always line buffered, so diagnostics
+/// written before a crash reach redirected logs too. Both are
+/// flushed at exit and on panic.
+///
+class PrintStream : public BufferedOutStream {
 public:
     enum class Catagory {
         Stdout,
         Stderr
     } catagory;
 
-    PrintStream(Catagory catagory) :
-        catagory(catagory)
-    {}
+    static constexpr ulen DEFAULT_BUFFER_SIZE=8192;
+
+    PrintStream(Catagory catagory, ulen buffer_size=DEFAULT_BUFFER_SIZE);
+
+    ~PrintStream();
 
 protected:
-    void flush_buffer(const char* buf, ulen size) override;
+    void write_out(const char* buf, ulen size,
+                   const char* extra, ulen extra_size) override;
 }
 extern stdout_stream,
        stderr_stream;
 
+/// Flushes both standard output and standard error.
+///
+void flush_std_streams();
+
 enum class TermColor {
     Default        = 0x7,
     Black          = 0x0,
@@ -68,7 +83,7 @@ inline void print(T&& value) {
 /// stream.
 ///
 template<typename... TArgs>
-inline void print(const char* fmt, TArgs&&... args) {
+inline void print(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
     stdout_stream.write(fmt, std::forward<TArgs>(args)...);
 }
 
@@ -84,7 +99,7 @@ inline void println(T&& value) {
 /// stream with a new line at the end.
 ///
 template<typename... TArgs>
-inline void println(const char* fmt, TArgs&&... args) {
+inline void println(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
     stdout_stream.writeln(fmt, std::forward<TArgs>(args)...);
 }
 
@@ -109,7 +124,7 @@ inline void eprint(T&& value) {
 /// stream.
 ///
 template<typename... TArgs>
-inline void eprint(const char* fmt, TArgs&&... args) {
+inline void eprint(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
     stderr_stream.write(fmt, std::forward<TArgs>(args)...);
 }
 
@@ -125,7 +140,7 @@ inline void eprintln(T&& value) {
 /// stream with a new line at the end.
 ///
 template<typename... TArgs>
-inline void eprintln(const char* fmt, TArgs&&... args) {
+inline void eprintln(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
     stderr_stream.writeln(fmt, std::forward<TArgs>(args)...);
 }
 
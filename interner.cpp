@@ -0,0 +1,41 @@
+#include "interner.h"
+
+namespace ssc {
+
+static constexpr ulen INTERNER_CHUNK_SIZE=1 << 16;
+
+StringInterner::StringInterner() :
+    arena(INTERNER_CHUNK_SIZE),
+    table(IdHash{ &entries }, IdEq{ &entries })
+{
+    entries.add(Entry{ "", hash_bytes("", 0), 0 });
+}
+
+Symbol StringInterner::intern(StrSlice str) {
+    if (str.size() > UINT32_MAX)
+        panic("interned string is too long");
+
+    Query query{ str, hash_bytes(str.data(), str.size()) };
+    if (const u32* id=table.find(query))
+        return Symbol{ *id };
+
+    if (entries.size() > UINT32_MAX)
+        panic("too many interned strings");
+
+    char* data=(char*) arena.alloc(str.size()+1, 1);
+    memcpy(data, str.data(), str.size());
+    data[str.size()]='\0';
+
+    u32 id=(u32) entries.size();
+    entries.add(Entry{ data, query.hash, (u32) str.size() });
+    table.insert(id);
+    return Symbol{ id };
+}
+
+Symbol StringInterner::find(StrSlice str) const {
+    Query query{ str, hash_bytes(str.data(), str.size()) };
+    if (const u32* id=table.find(query))
+        return Symbol{ *id };
+    return Symbol{};
+}
+}
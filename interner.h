@@ -0,0 +1,129 @@
+//===---------------------------------------------------------===
+//
+// Stores every unique identifier once and hands out small
+// handles for them.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_INTERNER_H
+#define SSC_INTERNER_H
+
+#include "mem.h"
+#include "util/List.h"
+#include "util/HashMap.h"
+#include "util/StrSlice.h"
+
+namespace ssc {
+
+/// A handle to a string of a StringInterner. Two symbols of
+/// the same interner are equal exactly when their strings are
+/// equal, so names are compared as integers.
+///
+/// The default symbol refers to no string.
+///
+struct Symbol {
+    u32 id=0;
+
+    bool valid() const { return id != 0; }
+
+    bool operator==(const Symbol& rhs) const = default;
+};
+
+template<>
+struct Hash<Symbol> {
+    u64 operator()(Symbol s) const {
+        return hash_u64(s.id);
+    }
+};
+
+/// Interns strings into an arena so each unique string is
+/// stored once along with its hash and length.
+///
+/// The strings are null terminated and stay at the same address
+/// until the interner is destroyed.
+///
+class StringInterner {
+public:
+    StringInterner();
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    /// Get the symbol of the string, storing a copy
+    /// of it if it has not been seen before.
+    ///
+    Symbol intern(StrSlice str);
+
+    /// Get the symbol of the string without interning it.
+    ///
+    /// \return an invalid symbol if the string has not
+    /// been interned.
+    ///
+    Symbol find(StrSlice str) const;
+
+    /// Get the string of a symbol.
+    ///
+    StrSlice str(Symbol sym) const {
+        const Entry& entry=entries[sym.id];
+        return StrSlice(entry.data, entry.size);
+    }
+
+    /// Get the null terminated string of a symbol.
+    ///
+    const char* c_str(Symbol sym) const {
+        return entries[sym.id].data;
+    }
+
+    /// Get the hash of the string of a symbol.
+    ///
+    u64 hash(Symbol sym) const {
+        return entries[sym.id].hash;
+    }
+
+    /// Get the number of strings interned.
+    ///
+    ulen size() const { return entries.size() - 1; }
+
+private:
+    struct Entry {
+        const char* data;
+        u64         hash;
+        u32         size;
+    };
+
+      // A string being looked up with its hash
+      // already computed.
+    struct Query {
+        StrSlice str;
+        u64      hash;
+    };
+
+      // The table only holds symbol ids and finds their strings
+      // and hashes through the entries, so each string is hashed
+      // once and its entry is not stored twice.
+    struct IdHash {
+        const List<Entry>* entries;
+
+        u64 operator()(u32 id) const { return (*entries)[id].hash; }
+        u64 operator()(const Query& q) const { return q.hash; }
+    };
+    struct IdEq {
+        const List<Entry>* entries;
+
+        bool operator()(u32 id, const Query& q) const {
+            const Entry& e=(*entries)[id];
+            return e.hash == q.hash && StrSlice(e.data, e.size) == q.str;
+        }
+        bool operator()(u32 id, u32 rhs) const {
+            return id == rhs;
+        }
+    };
+
+    ArenaAllocator                 arena;
+      // Indexed by symbol id, the first entry is
+      // for the invalid symbol.
+    List<Entry>                    entries;
+    HashSet<u32, IdHash, IdEq>     table;
+};
+}
+
+#endif
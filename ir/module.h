@@ -1,6 +1,8 @@
 #ifndef SSC_MODULE_H
 #define SSC_MODULE_H
 
+#include "util/BucketList.h"
+
 namespace ssc {
 
 class Function {
@@ -12,7 +14,15 @@ private:
 class Module {
 public:
     
+    /// Creates a new function in the module. The function
+    /// stays at the same address for the life of the module.
+    ///
+    Function& add_function() {
+        return functions.emplace();
+    }
+
 private:
+    BucketList<Function> functions;
 };
 }
 
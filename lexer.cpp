@@ -0,0 +1,392 @@
+#include "lexer.h"
+#include "characters.h"
+
+#include <cstring>   // for memcpy, memchr
+#include <algorithm> // for std::upper_bound, std::rotate
+
+namespace ssc {
+
+  // Indexed by TokenKind.
+static const char* const TOKEN_KIND_NAMES[]={
+    "end of file", "invalid token",
+    "identifier", "integer", "float", "string", "character",
+    "as", "break", "const", "continue", "else", "enum", "false", "fn",
+    "for", "if", "import", "in", "let", "loop", "match", "null", "pub",
+    "return", "struct", "true", "type", "var", "while",
+    "(", ")", "{", "}", "[", "]", ",", ";", ":", "::", ".", "..", "->",
+    "=>", "?", "@", "#", "$", "~", "+", "+=", "-", "-=", "*", "*=", "/",
+    "/=", "%", "%=", "&", "&&", "&=", "|", "||", "|=", "^", "^=", "!",
+    "!=", "=", "==", "<", "<=", "<<", "<<=", "<=>", ">", ">=", ">>", ">>=",
+};
+
+static_assert(sizeof(TOKEN_KIND_NAMES)/sizeof(TOKEN_KIND_NAMES[0]) == (ulen) TokenKind::ShrEq+1,
+              "every token kind needs a name");
+
+const char* token_kind_name(TokenKind kind) {
+    return TOKEN_KIND_NAMES[(ulen) kind];
+}
+
+  // Keyword lookup
+  //
+  // A keyword is found by hashing its first two bytes, its last
+  // byte and its length into a table with a slot for each keyword
+  // and no collisions. The multiplier of the hash is searched for
+  // at compile time so adding a keyword only means adding it here
+  // and to TokenKind. A hit is confirmed by comparing the bytes
+  // as one 64-bit word.
+
+static constexpr const char* KEYWORDS[]={
+    "as", "break", "const", "continue", "else", "enum", "false", "fn",
+    "for", "if", "import", "in", "let", "loop", "match", "null", "pub",
+    "return", "struct", "true", "type", "var", "while",
+};
+
+static constexpr ulen KEYWORD_COUNT=sizeof(KEYWORDS)/sizeof(KEYWORDS[0]);
+static constexpr ulen KEYWORD_MIN_SIZE=2;
+static constexpr ulen KEYWORD_MAX_SIZE=8;
+static constexpr u32  KEYWORD_TABLE_BITS=6;
+static constexpr ulen KEYWORD_TABLE_SIZE=1 << KEYWORD_TABLE_BITS;
+
+static_assert((ulen) TokenKind::KwWhile - (ulen) TokenKind::KwAs + 1 == KEYWORD_COUNT,
+              "every keyword needs a token kind");
+
+constexpr ulen const_strlen(const char* s) {
+    ulen size=0;
+    while (s[size])
+        ++size;
+    return size;
+}
+
+constexpr u32 keyword_key(const char* p, ulen size) {
+    return (u32) (u8) p[0] | (u32) (u8) p[1] << 8 |
+           (u32) (u8) p[size-1] << 16 | (u32) size << 24;
+}
+
+constexpr u32 keyword_slot(u32 key, u32 multiplier) {
+    return (key * multiplier) >> (32 - KEYWORD_TABLE_BITS);
+}
+
+constexpr u32 find_keyword_multiplier() {
+    for (u32 multiplier=0x9E3779B1u; ; multiplier += 2) {
+        bool used[KEYWORD_TABLE_SIZE]={};
+        bool perfect=true;
+        for (const char* keyword : KEYWORDS) {
+            u32 slot=keyword_slot(keyword_key(keyword, const_strlen(keyword)), multiplier);
+            if (used[slot]) {
+                perfect=false;
+                break;
+            }
+            used[slot]=true;
+        }
+        if (perfect)
+            return multiplier;
+    }
+}
+
+static constexpr u32 KEYWORD_MULTIPLIER=find_keyword_multiplier();
+
+struct KeywordSlot {
+      // The keyword's bytes as a little endian word,
+      // zero past the end.
+    u64       word=0;
+    u8        size=0;
+    TokenKind kind=TokenKind::Ident;
+};
+
+constexpr std::array<KeywordSlot, KEYWORD_TABLE_SIZE> make_keyword_table() {
+    std::array<KeywordSlot, KEYWORD_TABLE_SIZE> table{};
+    for (ulen i=0; i < KEYWORD_COUNT; ++i) {
+        const char* keyword=KEYWORDS[i];
+        ulen size=const_strlen(keyword);
+        KeywordSlot& slot=table[keyword_slot(keyword_key(keyword, size), KEYWORD_MULTIPLIER)];
+        for (ulen j=0; j < size; ++j)
+            slot.word |= (u64) (u8) keyword[j] << (j*8);
+        slot.size=(u8) size;
+        slot.kind=(TokenKind) ((ulen) TokenKind::KwAs + i);
+    }
+    return table;
+}
+
+static constexpr std::array<KeywordSlot, KEYWORD_TABLE_SIZE> KEYWORD_TABLE=make_keyword_table();
+
+  // Reads past the end of the identifier, which
+  // the padding after the source allows.
+static TokenKind keyword_kind(const char* p, ulen size) {
+    if (size < KEYWORD_MIN_SIZE || size > KEYWORD_MAX_SIZE)
+        return TokenKind::Ident;
+    const KeywordSlot& slot=KEYWORD_TABLE[keyword_slot(keyword_key(p, size), KEYWORD_MULTIPLIER)];
+    u64 word;
+    memcpy(&word, p, sizeof(word));
+    u64 mask=size == 8 ? ~(u64) 0 : ((u64) 1 << (size*8)) - 1;
+    if (slot.size == size && (word & mask) == slot.word)
+        return slot.kind;
+    return TokenKind::Ident;
+}
+
+  // Runs of whitespace between tokens are mostly a single space
+  // or a new line and an indent, which are skipped one byte at a
+  // time before handing a longer run to the scanner.
+static const char* lex_whitespace(const char* p, const char* end) {
+    for (int i=0; i < 8; ++i, ++p)
+        if (!is_whitespace(*p))
+            return p;
+    return skip_whitespace(p, end);
+}
+
+  // Identifiers are usually short so the first bytes are checked
+  // one at a time before handing a long one to the scanner.
+static const char* lex_ident(const char* p, const char* end) {
+    for (int i=0; i < 16; ++i, ++p)
+        if (!is_ident_cont(*p))
+            return p;
+    return find_ident_end(p, end);
+}
+
+static const char* lex_number(const char* p, TokenKind& kind) {
+    kind=TokenKind::Int;
+    if (p[0] == '0' && (p[1] | 0x20) == 'x') {
+        p += 2;
+        while (is_hex_digit(*p) || *p == '_')
+            ++p;
+    } else {
+        while (is_digit(*p) || *p == '_')
+            ++p;
+        // `1..2` is a range rather than a float.
+        if (*p == '.' && is_digit(p[1])) {
+            kind=TokenKind::Float;
+            p += 2;
+            while (is_digit(*p) || *p == '_')
+                ++p;
+        }
+        if ((*p | 0x20) == 'e' &&
+            (is_digit(p[1]) || ((p[1] == '+' || p[1] == '-') && is_digit(p[2])))) {
+            kind=TokenKind::Float;
+            p += 2;
+            while (is_digit(*p))
+                ++p;
+        }
+    }
+    // Suffixes such as `u32`, and the digits of `0b` and
+    // `0o` literals, are checked by the parser.
+    while (is_ident_cont(*p))
+        ++p;
+    return p;
+}
+
+  // Starts after the opening quote.
+  //
+  // \return false if the literal ends at a new line or the end
+  // of the file, which `p` is left pointing at.
+static bool lex_quoted(const char*& p, const char* end, char quote) {
+    for (;;) {
+        p=find_quote_or_newline(p, end, quote);
+        if (*p == quote) {
+            ++p;
+            return true;
+        }
+        if (*p == '\\') {
+            if (p+1 < end && p[1] != '\n') {
+                p += 2;
+                continue;
+            }
+            ++p;
+        }
+        return false;
+    }
+}
+
+  // Starts after the `/*`. Block comments do not nest.
+  //
+  // \return false if the comment has no end.
+static bool skip_block_comment(const char*& p, const char* end) {
+    for (;;) {
+        const char* star=(const char*) memchr(p, '*', (ulen) (end-p));
+        if (!star) {
+            p=end;
+            return false;
+        }
+        if (star[1] == '/') {
+            p=star+2;
+            return true;
+        }
+        p=star+1;
+    }
+}
+
+  // Picks the longest operator starting at `p`.
+static TokenKind lex_operator(const char*& p) {
+    char c=*p++;
+    auto next=[&](char expect) {
+        if (*p != expect)
+            return false;
+        ++p;
+        return true;
+    };
+    switch (c) {
+        case '(': return TokenKind::LParen;
+        case ')': return TokenKind::RParen;
+        case '{': return TokenKind::LBrace;
+        case '}': return TokenKind::RBrace;
+        case '[': return TokenKind::LBracket;
+        case ']': return TokenKind::RBracket;
+        case ',': return TokenKind::Comma;
+        case ';': return TokenKind::Semicolon;
+        case '?': return TokenKind::Question;
+        case '@': return TokenKind::At;
+        case '#': return TokenKind::Hash;
+        case '$': return TokenKind::Dollar;
+        case '~': return TokenKind::Tilde;
+        case ':': return next(':') ? TokenKind::ColonColon : TokenKind::Colon;
+        case '.': return next('.') ? TokenKind::DotDot : TokenKind::Dot;
+        case '+': return next('=') ? TokenKind::PlusEq : TokenKind::Plus;
+        case '*': return next('=') ? TokenKind::StarEq : TokenKind::Star;
+        case '/': return next('=') ? TokenKind::SlashEq : TokenKind::Slash;
+        case '%': return next('=') ? TokenKind::PercentEq : TokenKind::Percent;
+        case '^': return next('=') ? TokenKind::CaretEq : TokenKind::Caret;
+        case '!': return next('=') ? TokenKind::BangEq : TokenKind::Bang;
+        case '-':
+            if (next('>')) return TokenKind::Arrow;
+            return next('=') ? TokenKind::MinusEq : TokenKind::Minus;
+        case '=':
+            if (next('>')) return TokenKind::FatArrow;
+            return next('=') ? TokenKind::EqEq : TokenKind::Eq;
+        case '&':
+            if (next('&')) return TokenKind::AmpAmp;
+            return next('=') ? TokenKind::AmpEq : TokenKind::Amp;
+        case '|':
+            if (next('|')) return TokenKind::PipePipe;
+            return next('=') ? TokenKind::PipeEq : TokenKind::Pipe;
+        case '<':
+            if (next('<'))
+                return next('=') ? TokenKind::ShlEq : TokenKind::Shl;
+            if (next('='))
+                return next('>') ? TokenKind::Spaceship : TokenKind::LtEq;
+            return TokenKind::Lt;
+        case '>':
+            if (next('>'))
+                return next('=') ? TokenKind::ShrEq : TokenKind::Shr;
+            return next('=') ? TokenKind::GtEq : TokenKind::Gt;
+        default:
+            return TokenKind::Error;
+    }
+}
+
+  // Makes the token holding the first invalid UTF-8 sequence of
+  // the tokens from `first` an Error token, or adds an Error token
+  // for the sequence where it is in whitespace or a comment.
+  //
+  // \return the number of Error tokens added.
+static ulen report_encoding_error(Tokens& tokens, ulen first, SourceLoc error,
+                                  const StringInterner& interner) {
+    std::span<SourceLoc> locs=tokens.columns.column<Tokens::LOC>();
+    ulen idx=(ulen) (std::upper_bound(locs.begin() + first, locs.end(), error) - locs.begin());
+    if (idx > first) {
+        ulen prev=idx-1;
+        TokenKind kind=tokens.kind(prev);
+        u32 length=kind == TokenKind::Ident ? (u32) interner.str(tokens.symbol(prev)).size()
+                                            : tokens.length(prev);
+        if (error < tokens.loc(prev) + length) {
+            if (kind == TokenKind::Error)
+                return 0;
+            tokens.columns.get<Tokens::KIND>(prev)=TokenKind::Error;
+            tokens.columns.get<Tokens::DATA>(prev)=length;
+            return 1;
+        }
+    }
+
+    // Inserting the token, which only happens once per file.
+    tokens.columns.add(TokenKind::Error, error, 1u);
+    auto shift=[&](auto column) {
+        std::rotate(column.begin() + idx, column.end()-1, column.end());
+    };
+    shift(tokens.columns.column<Tokens::KIND>());
+    shift(tokens.columns.column<Tokens::LOC>());
+    shift(tokens.columns.column<Tokens::DATA>());
+    return 1;
+}
+
+ulen Lexer::lex(Tokens& tokens) {
+    const char* begin=file.data;
+    const char* end=begin + file.size;
+    const char* p=begin + file.utf8.bom_size;
+    ulen first=tokens.size();
+    ulen errors=0;
+
+    // Few sources have more than a token for every four bytes so
+    // the columns are rarely moved, and the pages past the last
+    // token are never touched.
+    tokens.columns.reserve(tokens.size() + file.size/4 + 1);
+
+    auto add=[&](TokenKind kind, const char* start, u32 data) {
+        tokens.columns.add(kind, file.start + (SourceOffset) (start - begin), data);
+        errors += kind == TokenKind::Error;
+    };
+
+    for (;;) {
+        const char* start=p;
+        u8 classes=CHAR_CLASSES[(u8) *p];
+
+        if (classes & (CHAR_SPACE | CHAR_NEWLINE)) {
+            p=lex_whitespace(p+1, end);
+            continue;
+        }
+
+        if (classes & CHAR_IDENT_START) {
+            p=lex_ident(p+1, end);
+            ulen size=(ulen) (p - start);
+            TokenKind kind=keyword_kind(start, size);
+            if (kind == TokenKind::Ident)
+                add(kind, start, interner.intern(StrSlice(start, size)).id);
+            else
+                add(kind, start, (u32) size);
+            continue;
+        }
+
+        if (classes & CHAR_DIGIT) {
+            TokenKind kind;
+            p=lex_number(p, kind);
+            add(kind, start, (u32) (p - start));
+            continue;
+        }
+
+        switch (*p) {
+            case '\0':
+                if (p == end) {
+                    add(TokenKind::Eof, p, 0);
+                    if (!file.utf8.valid())
+                        errors += report_encoding_error(tokens, first,
+                                                        file.start + (SourceOffset) file.utf8.error_offset,
+                                                        interner);
+                    return errors;
+                }
+                ++p;
+                add(TokenKind::Error, start, 1);
+                continue;
+            case '"':
+            case '\'': {
+                char quote=*p++;
+                TokenKind kind=quote == '"' ? TokenKind::String : TokenKind::Char;
+                if (!lex_quoted(p, end, quote))
+                    kind=TokenKind::Error;
+                add(kind, start, (u32) (p - start));
+                continue;
+            }
+            case '/':
+                if (p[1] == '/') {
+                    p=find_newline(p+2, end);
+                    continue;
+                }
+                if (p[1] == '*') {
+                    p += 2;
+                    if (!skip_block_comment(p, end))
+                        add(TokenKind::Error, start, (u32) (p - start));
+                    continue;
+                }
+                break;
+        }
+
+        TokenKind kind=lex_operator(p);
+        add(kind, start, (u32) (p - start));
+    }
+}
+}
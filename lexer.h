@@ -0,0 +1,178 @@
+//===---------------------------------------------------------===
+//
+// Splits a source file into tokens which are stored by column
+// rather than as one object per token.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_LEXER_H
+#define SSC_LEXER_H
+
+#include "source.h"
+#include "interner.h"
+#include "util/SoAList.h"
+
+namespace ssc {
+
+enum class TokenKind : u8 {
+    Eof,
+      // A byte which starts no token, a string or comment
+      // without an end, a stray null byte, or the token holding
+      // the first invalid UTF-8 sequence.
+    Error,
+
+    Ident,
+    Int,
+    Float,
+    String,
+    Char,
+
+      // Keywords, kept in the same order as KEYWORDS.
+    KwAs,
+    KwBreak,
+    KwConst,
+    KwContinue,
+    KwElse,
+    KwEnum,
+    KwFalse,
+    KwFn,
+    KwFor,
+    KwIf,
+    KwImport,
+    KwIn,
+    KwLet,
+    KwLoop,
+    KwMatch,
+    KwNull,
+    KwPub,
+    KwReturn,
+    KwStruct,
+    KwTrue,
+    KwType,
+    KwVar,
+    KwWhile,
+
+    LParen,     // (
+    RParen,     // )
+    LBrace,     // {
+    RBrace,     // }
+    LBracket,   // [
+    RBracket,   // ]
+    Comma,      // ,
+    Semicolon,  // ;
+    Colon,      // :
+    ColonColon, // ::
+    Dot,        // .
+    DotDot,     // ..
+    Arrow,      // ->
+    FatArrow,   // =>
+    Question,   // ?
+    At,         // @
+    Hash,       // #
+    Dollar,     // $
+    Tilde,      // ~
+    Plus,       // +
+    PlusEq,     // +=
+    Minus,      // -
+    MinusEq,    // -=
+    Star,       // *
+    StarEq,     // *=
+    Slash,      // /
+    SlashEq,    // /=
+    Percent,    // %
+    PercentEq,  // %=
+    Amp,        // &
+    AmpAmp,     // &&
+    AmpEq,      // &=
+    Pipe,       // |
+    PipePipe,   // ||
+    PipeEq,     // |=
+    Caret,      // ^
+    CaretEq,    // ^=
+    Bang,       // !
+    BangEq,     // !=
+    Eq,         // =
+    EqEq,       // ==
+    Lt,         // <
+    LtEq,       // <=
+    Shl,        // <<
+    ShlEq,      // <<=
+    Spaceship,  // <=>
+    Gt,         // >
+    GtEq,       // >=
+    Shr,        // >>
+    ShrEq,      // >>=
+};
+
+/// Get the spelling of a keyword or punctuation token, or
+/// a description of the other kinds.
+///
+const char* token_kind_name(TokenKind kind);
+
+/// The tokens of a file stored as columns. The first column is
+/// the kind of each token, the second its location and the
+/// third its interned symbol for identifiers and its length in
+/// bytes for everything else.
+///
+/// The last token is always an Eof token.
+///
+class Tokens {
+public:
+    static constexpr ulen KIND=0;
+    static constexpr ulen LOC=1;
+    static constexpr ulen DATA=2;
+
+    SoAList<TokenKind, SourceLoc, u32> columns;
+
+    ulen size() const { return columns.size(); }
+
+    TokenKind kind(ulen idx) const { return columns.get<KIND>(idx); }
+    SourceLoc loc(ulen idx) const { return columns.get<LOC>(idx); }
+
+    /// Get the symbol of an identifier.
+    ///
+    Symbol symbol(ulen idx) const {
+        DBG_ASSERT(kind(idx) == TokenKind::Ident, "only identifiers have symbols");
+        return Symbol{ columns.get<DATA>(idx) };
+    }
+
+    /// Get the length of a token other than an identifier.
+    ///
+    u32 length(ulen idx) const {
+        DBG_ASSERT(kind(idx) != TokenKind::Ident, "identifiers store their symbol");
+        return columns.get<DATA>(idx);
+    }
+};
+
+/// Lexes a whole file at a time.
+///
+/// Bytes are classified with the character class table and runs
+/// of whitespace, identifier characters and string contents are
+/// skipped with the vectorized scanners. The zero padding after
+/// the file stands in for checks against the end. Keywords are
+/// told apart from identifiers with a perfect hash so an
+/// identifier costs at most one comparison before it is interned.
+///
+class Lexer {
+public:
+    Lexer(const SourceFile& file, StringInterner& interner) :
+        file(file),
+        interner(interner)
+    {}
+
+    /// Appends the tokens of the file to `tokens`.
+    ///
+    /// Where the file is not valid UTF-8, the token holding the
+    /// first invalid sequence becomes an Error token, or an Error
+    /// token is added for it if it is in whitespace or a comment.
+    ///
+    /// \return the number of Error tokens.
+    ///
+    ulen lex(Tokens& tokens);
+
+private:
+    const SourceFile& file;
+    StringInterner&   interner;
+};
+}
+
+#endif
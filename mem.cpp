@@ -1,5 +1,15 @@
 #include "mem.h"
 
+#include <new>   // for placement new
+#include <mutex>
+#include <bit>   // for std::bit_width
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 ulen ssc::next_pow_of2(ulen v) {
     --v;
 	v |= v >> 1;
@@ -7,6 +17,8 @@ ulen ssc::next_pow_of2(ulen v) {
 	v |= v >> 4;
 	v |= v >> 8;
 	v |= v >> 16;
+	// Two shifts so a 32-bit ulen is never shifted by its width.
+	v |= v >> 16 >> 16;
 	++v;
 	return v;
 }
@@ -15,17 +27,576 @@ void ssc::ArenaAllocator::free(void* ptr) {
     // Compatibility only
 }
 
-uintptr_t ssc::ArenaAllocator::get_aligned_offset(ulen align) {
-    uintptr_t pos=(uintptr_t)cur_chunk+offset; 
-    uintptr_t r=pos&(align-1);
-    if (r) {
-        // Not aligned. Aligning
-        pos += align - r;
+void* ssc::ArenaAllocator::alloc_slow(ulen size, ulen align) {
+    // Chunk memory is aligned for the header so the worst case
+    // is having to skip almost `align` bytes.
+    ulen needed=size + (align > alignof(Chunk) ? align-1 : 0);
+
+    if (needed > next_chunk_size / 2) {
+        // Large enough that starting a new chunk for it would waste
+        // the rest of the current chunk, so it gets its own chunk.
+        large_chunks = alloc_chunk(needed, large_chunks);
+        uintptr_t start=(uintptr_t) (large_chunks + 1);
+        return (void*) ((start + align-1) & ~(uintptr_t)(align-1));
     }
-    return pos;
+
+    // Reusing a chunk released by rewinding if one is big enough.
+    Chunk** spare=&spare_chunks;
+    while (*spare && (*spare)->size < needed)
+        spare = &(*spare)->prev;
+    if (*spare) {
+        Chunk* chunk=*spare;
+        *spare = chunk->prev;
+        chunk->prev = chunks;
+        chunks = chunk;
+    } else {
+        chunks = alloc_chunk(next_chunk_size, chunks);
+        if (next_chunk_size < max_chunk_size) {
+            next_chunk_size <<= 1;
+            if (next_chunk_size > max_chunk_size)
+                next_chunk_size = max_chunk_size;
+        }
+    }
+    pos = (uintptr_t) (chunks + 1);
+    end = pos + chunks->size;
+
+    uintptr_t aligned=(pos + align-1) & ~(uintptr_t)(align-1);
+    pos = aligned + size;
+    return (void*) aligned;
 }
 
-ssc::ArenaAllocator::~ArenaAllocator() {
-    for (void* chunk : chunks)
+ssc::ArenaAllocator::Chunk* ssc::ArenaAllocator::alloc_chunk(ulen size, Chunk* prev) {
+    Chunk* chunk=(Chunk*) std::malloc(sizeof(Chunk) + size);
+    if (!chunk)
+        panic("Out of memory");
+    chunk->prev = prev;
+    chunk->size = size;
+    return chunk;
+}
+
+void ssc::ArenaAllocator::free_chunks(Chunk* chunk) {
+    while (chunk) {
+        Chunk* prev=chunk->prev;
         std::free(chunk);
+        chunk = prev;
+    }
+}
+
+void ssc::ArenaAllocator::rewind(const Mark& m) {
+    while (large_chunks != m.large_chunk) {
+        Chunk* prev=large_chunks->prev;
+        std::free(large_chunks);
+        large_chunks = prev;
+    }
+    // Newer chunks go to the spare list, ending up with the
+    // oldest on top so they get reused in the same order.
+    while (chunks != m.chunk) {
+        Chunk* prev=chunks->prev;
+        chunks->prev = spare_chunks;
+        spare_chunks = chunks;
+        chunks = prev;
+    }
+    pos = m.pos;
+    end = chunks ? (uintptr_t) (chunks + 1) + chunks->size : 0;
+}
+
+void ssc::ArenaAllocator::trim() {
+    free_chunks(spare_chunks);
+    spare_chunks = nullptr;
+}
+
+ssc::ArenaAllocator::~ArenaAllocator() {
+    free_chunks(chunks);
+    free_chunks(large_chunks);
+    free_chunks(spare_chunks);
+}
+
+ssc::VirtualArenaAllocator::VirtualArenaAllocator(ulen reserve_size, bool huge_pages) {
+    commit_size = huge_pages ? HUGE_PAGE_SIZE : COMMIT_SIZE;
+    reserve_size = (reserve_size + commit_size-1) & ~(commit_size-1);
+    // Reserving an extra step so the start can be aligned to
+    // the commit size.
+    reservation_size = reserve_size + commit_size;
+#ifdef _WIN32
+    reservation = VirtualAlloc(nullptr, reservation_size, MEM_RESERVE, PAGE_NOACCESS);
+    if (!reservation)
+        panic("Failed to reserve virtual memory");
+#else
+    reservation = mmap(nullptr, reservation_size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED)
+        panic("Failed to reserve virtual memory");
+#endif
+    base = ((uintptr_t) reservation + commit_size-1) & ~(uintptr_t)(commit_size-1);
+    pos          = base;
+    committed    = base;
+    reserved_end = base + reserve_size;
+#if defined(MADV_HUGEPAGE)
+    if (huge_pages)
+        madvise((void*) base, reserve_size, MADV_HUGEPAGE);
+#endif
+}
+
+ssc::VirtualArenaAllocator::~VirtualArenaAllocator() {
+#ifdef _WIN32
+    VirtualFree(reservation, 0, MEM_RELEASE);
+#else
+    munmap(reservation, reservation_size);
+#endif
+}
+
+void ssc::VirtualArenaAllocator::commit(uintptr_t needed) {
+    if (needed > reserved_end)
+        panic("Virtual arena ran out of reserved memory");
+    uintptr_t new_committed=(needed + commit_size-1) & ~(uintptr_t)(commit_size-1);
+#ifdef _WIN32
+    if (!VirtualAlloc((void*) committed, new_committed - committed, MEM_COMMIT, PAGE_READWRITE))
+        panic("Failed to commit virtual memory");
+#else
+    if (mprotect((void*) committed, new_committed - committed, PROT_READ | PROT_WRITE) != 0)
+        panic("Failed to commit virtual memory");
+#endif
+    committed = new_committed;
+}
+
+void ssc::VirtualArenaAllocator::purge() {
+    pos = base;
+    if (committed == base)
+        return;
+#ifdef _WIN32
+    VirtualFree((void*) base, committed - base, MEM_DECOMMIT);
+    committed = base;
+#else
+    // The pages stay accessible and are zero filled again when
+    // next touched.
+    madvise((void*) base, committed - base, MADV_DONTNEED);
+#endif
+}
+
+// Satisfying linkage
+//
+namespace ssc {
+thread_local ConcurrentArenaAllocator::ThreadCacheEntry
+    ConcurrentArenaAllocator::thread_cache[THREAD_CACHE_SIZE] {};
+// Starting at 1 so that empty cache entries never match.
+std::atomic<u64> ConcurrentArenaAllocator::next_uid { 1 };
+}
+
+ssc::ConcurrentArenaAllocator::ConcurrentArenaAllocator(ulen slab_size, ulen thread_chunk_size) :
+    uid(next_uid.fetch_add(1, std::memory_order_relaxed)),
+    slab_size(slab_size),
+    thread_chunk_size(thread_chunk_size),
+    slab(nullptr)
+{}
+
+ssc::ConcurrentArenaAllocator::~ConcurrentArenaAllocator() {
+    Slab* s=slab.load(std::memory_order_acquire);
+    while (s) {
+        Slab* prev=s->prev;
+        std::free(s);
+        s = prev;
+    }
+    LargeBlock* block=large_blocks.load(std::memory_order_acquire);
+    while (block) {
+        LargeBlock* prev=block->prev;
+        std::free(block);
+        block = prev;
+    }
+}
+
+ssc::ConcurrentArenaAllocator::Slab*
+ssc::ConcurrentArenaAllocator::install_slab(Slab* expected, ulen min_size) {
+    ulen size=min_size > slab_size ? min_size : slab_size;
+    Slab* s=(Slab*) std::malloc(sizeof(Slab) + size);
+    if (!s)
+        panic("Out of memory");
+    s->prev = expected;
+    s->size = size;
+    new (&s->used) std::atomic<ulen>(0);
+    if (slab.compare_exchange_strong(expected, s,
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_acquire))
+        return s;
+    // Another thread installed a slab first.
+    std::free(s);
+    return expected;
+}
+
+void* ssc::ConcurrentArenaAllocator::alloc_shared(ulen size, ulen align) {
+    // Sizes are rounded so that offsets into the slab stay
+    // aligned to the default alignment.
+    ulen rounded=(size + DEFAULT_ALIGNMENT-1) & ~(DEFAULT_ALIGNMENT-1);
+    if (align > DEFAULT_ALIGNMENT)
+        rounded += align - DEFAULT_ALIGNMENT;
+    if (rounded > slab_size / 4)
+        return alloc_large(size, align);
+
+    Slab* s=slab.load(std::memory_order_acquire);
+    while (true) {
+        if (s) {
+            ulen offset=s->used.fetch_add(rounded, std::memory_order_relaxed);
+            if (offset + rounded <= s->size) {
+                uintptr_t start=(uintptr_t) (s + 1) + offset;
+                return (void*) ((start + align-1) & ~(uintptr_t)(align-1));
+            }
+        }
+        s = install_slab(s, rounded);
+    }
+}
+
+void* ssc::ConcurrentArenaAllocator::alloc_large(ulen size, ulen align) {
+    ulen header=sizeof(LargeBlock) > align ? sizeof(LargeBlock) : align;
+    LargeBlock* block=(LargeBlock*) std::malloc(header + size + align);
+    if (!block)
+        panic("Out of memory");
+    block->prev = large_blocks.load(std::memory_order_relaxed);
+    while (!large_blocks.compare_exchange_weak(block->prev, block,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+    uintptr_t start=(uintptr_t) block + header;
+    return (void*) ((start + align-1) & ~(uintptr_t)(align-1));
+}
+
+ssc::ConcurrentArenaAllocator::ThreadChunk*
+ssc::ConcurrentArenaAllocator::register_thread(ThreadCacheEntry& entry) {
+    std::thread::id self=std::this_thread::get_id();
+    ThreadChunk* head=thread_chunks.load(std::memory_order_acquire);
+    ThreadChunk* chunk=head;
+    while (chunk && chunk->owner != self)
+        chunk = chunk->next;
+
+    // Only this thread can add a chunk for itself so the chunk
+    // cannot have been added since the search.
+    if (!chunk) {
+        chunk=(ThreadChunk*) alloc_shared(sizeof(ThreadChunk), alignof(ThreadChunk));
+        chunk->pos   = chunk->end = 0;
+        chunk->owner = self;
+        chunk->next  = head;
+        while (!thread_chunks.compare_exchange_weak(chunk->next, chunk,
+                                                    std::memory_order_release,
+                                                    std::memory_order_acquire));
+    }
+    entry.uid   = uid;
+    entry.chunk = chunk;
+    return chunk;
+}
+
+void* ssc::ConcurrentArenaAllocator::alloc_slow(ThreadChunk* chunk, ulen size, ulen align) {
+    if (size + align > thread_chunk_size / 2)
+        return alloc_shared(size, align);
+    uintptr_t start=(uintptr_t) alloc_shared(thread_chunk_size, CACHE_LINE_SIZE);
+    chunk->end = start + thread_chunk_size;
+    uintptr_t aligned=(start + align-1) & ~(uintptr_t)(align-1);
+    chunk->pos = aligned + size;
+    return (void*) aligned;
+}
+
+// ===------------------------------------------------------
+// SlabAllocator
+
+namespace {
+
+using ssc::SlabAllocator;
+
+// 16 byte steps up to 128 then four classes per power of two.
+const ulen NUM_SIZE_CLASSES=8 + 4*5;
+// Number of objects a thread takes from a slab at once and
+// the number it may keep cached per class.
+const ulen REFILL_BATCH=32;
+const ulen MAX_CACHED=128;
+
+constexpr ulen class_size(ulen cls) {
+    if (cls < 8)
+        return (cls+1) * 16;
+    ulen group=(cls-8) / 4, step=(cls-8) % 4;
+    return ((ulen) 128 << group) + (step+1) * ((ulen) 32 << group);
+}
+
+ulen size_class(ulen size) {
+    if (size <= 128)
+        return size ? (size+15)/16 - 1 : 0;
+    ulen bits=std::bit_width(size-1);
+    return 8 + (bits-8)*4 + ((size-1) >> (bits-3)) - 4;
+}
+
+struct FreeObject {
+    FreeObject* next;
+};
+
+struct alignas(64) Slab {
+    u32         size_class;
+    u32         used;        // objects handed out of the slab
+    ulen        bump;        // offset of the never used memory
+    FreeObject* free_list;
+    Slab*       prev;        // links in the partial list of the class
+    Slab*       next;
+};
+
+inline Slab* slab_of(void* ptr) {
+    return (Slab*) ((uintptr_t) ptr & ~(uintptr_t)(SlabAllocator::SLAB_SIZE-1));
+}
+
+// Records which SLAB_SIZE aligned blocks of the address space are
+// slabs, so free() can tell small objects from large blocks which
+// come straight from malloc. The map has a bit per block, split
+// into leaves which are created the first time a slab falls in
+// their range.
+const ulen SLAB_SHIFT=16;
+const ulen SLAB_MAP_LEAF_BITS=16;
+const ulen SLAB_MAP_ROOT_SIZE=1 << 16;
+
+static_assert(SlabAllocator::SLAB_SIZE == (ulen) 1 << SLAB_SHIFT);
+
+struct SlabMapLeaf {
+    std::atomic<u64> words[((ulen) 1 << SLAB_MAP_LEAF_BITS) / 64];
+};
+
+std::atomic<SlabMapLeaf*> slab_map[SLAB_MAP_ROOT_SIZE];
+
+void slab_map_position(const void* slab, uintptr_t& root, uintptr_t& bit) {
+    uintptr_t block=(uintptr_t) slab >> SLAB_SHIFT;
+    root = block >> SLAB_MAP_LEAF_BITS;
+    bit  = block & (((uintptr_t) 1 << SLAB_MAP_LEAF_BITS) - 1);
+}
+
+void slab_map_set(const void* slab, bool is_slab) {
+    uintptr_t root, bit;
+    slab_map_position(slab, root, bit);
+    if (root >= SLAB_MAP_ROOT_SIZE)
+        ssc::panic("Slab outside of the slab map");
+    SlabMapLeaf* leaf=slab_map[root].load(std::memory_order_acquire);
+    if (!leaf) {
+        SlabMapLeaf* created=(SlabMapLeaf*) std::calloc(1, sizeof(SlabMapLeaf));
+        if (!created)
+            ssc::panic("Out of memory");
+        if (slab_map[root].compare_exchange_strong(leaf, created,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire))
+            leaf = created;
+        else
+            std::free(created);
+    }
+    u64 mask=(u64) 1 << (bit % 64);
+    if (is_slab)
+        leaf->words[bit / 64].fetch_or(mask, std::memory_order_release);
+    else
+        leaf->words[bit / 64].fetch_and(~mask, std::memory_order_release);
+}
+
+// A slab is registered before any of its objects are handed out,
+// which orders the registration before any free() of them.
+bool slab_map_contains(const void* slab) {
+    uintptr_t root, bit;
+    slab_map_position(slab, root, bit);
+    if (root >= SLAB_MAP_ROOT_SIZE)
+        return false;
+    SlabMapLeaf* leaf=slab_map[root].load(std::memory_order_acquire);
+    if (!leaf)
+        return false;
+    u64 word=leaf->words[bit / 64].load(std::memory_order_acquire);
+    return (word >> (bit % 64)) & 1;
+}
+
+void* alloc_slab() {
+#ifdef _WIN32
+    void* ptr=_aligned_malloc(SlabAllocator::SLAB_SIZE, SlabAllocator::SLAB_SIZE);
+#else
+    void* ptr;
+    if (posix_memalign(&ptr, SlabAllocator::SLAB_SIZE, SlabAllocator::SLAB_SIZE) != 0)
+        ptr = nullptr;
+#endif
+    if (!ptr)
+        ssc::panic("Out of memory");
+    slab_map_set(ptr, true);
+    return ptr;
+}
+
+void free_slab(void* ptr) {
+    slab_map_set(ptr, false);
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+/// The slabs of a single size class shared by all threads.
+///
+struct CentralClass {
+    std::mutex lock;
+    Slab*      partial=nullptr; // slabs which have free objects
+    Slab*      empty=nullptr;   // kept to avoid thrashing the system
+
+    void link(Slab* slab) {
+        slab->prev = nullptr;
+        slab->next = partial;
+        if (partial)
+            partial->prev = slab;
+        partial = slab;
+    }
+
+    void unlink(Slab* slab) {
+        if (slab->prev)
+            slab->prev->next = slab->next;
+        else
+            partial = slab->next;
+        if (slab->next)
+            slab->next->prev = slab->prev;
+    }
+
+    bool has_free(Slab* slab, ulen obj_size) const {
+        return slab->free_list || slab->bump + obj_size <= SlabAllocator::SLAB_SIZE;
+    }
+
+    /// Takes up to `count` objects and links them into `out`.
+    ///
+    ulen take(ulen cls, ulen count, FreeObject*& out) {
+        std::lock_guard<std::mutex> guard(lock);
+        ulen obj_size=class_size(cls), taken=0;
+        while (taken < count) {
+            Slab* slab=partial;
+            if (!slab) {
+                if (empty) {
+                    slab = empty;
+                    empty = nullptr;
+                } else {
+                    slab = (Slab*) alloc_slab();
+                    slab->size_class = (u32) cls;
+                    slab->used       = 0;
+                    slab->bump       = sizeof(Slab);
+                    slab->free_list  = nullptr;
+                }
+                link(slab);
+            }
+            while (taken < count && has_free(slab, obj_size)) {
+                FreeObject* obj;
+                if (slab->free_list) {
+                    obj = slab->free_list;
+                    slab->free_list = obj->next;
+                } else {
+                    obj = (FreeObject*) ((char*) slab + slab->bump);
+                    slab->bump += obj_size;
+                }
+                obj->next = out;
+                out = obj;
+                ++slab->used, ++taken;
+            }
+            if (!has_free(slab, obj_size))
+                unlink(slab);
+        }
+        return taken;
+    }
+
+    /// Returns the objects of the list to their slabs.
+    ///
+    void give_back(ulen cls, FreeObject* list) {
+        std::lock_guard<std::mutex> guard(lock);
+        ulen obj_size=class_size(cls);
+        while (list) {
+            FreeObject* obj=list;
+            list = list->next;
+            Slab* slab=slab_of(obj);
+            if (!has_free(slab, obj_size))
+                link(slab); // was full
+            obj->next = slab->free_list;
+            slab->free_list = obj;
+            if (--slab->used == 0) {
+                unlink(slab);
+                // Resetting the slab so its memory is reused from
+                // the start when kept.
+                slab->bump      = sizeof(Slab);
+                slab->free_list = nullptr;
+                if (!empty)
+                    empty = slab;
+                else
+                    free_slab(slab);
+            }
+        }
+    }
+};
+
+CentralClass central[NUM_SIZE_CLASSES];
+
+// Set once the thread's cache is destroyed. Destructors which run
+// after it, such as those of other thread locals or statics, use
+// the central lists directly. Trivially destructible so it stays
+// readable for the whole teardown.
+thread_local bool thread_cache_destroyed=false;
+
+/// Free objects cached by a single thread.
+///
+struct ThreadCache {
+    FreeObject* lists[NUM_SIZE_CLASSES] {};
+    ulen        counts[NUM_SIZE_CLASSES] {};
+
+    ~ThreadCache() {
+        thread_cache_destroyed = true;
+        for (ulen cls=0; cls<NUM_SIZE_CLASSES; cls++)
+            if (lists[cls])
+                central[cls].give_back(cls, lists[cls]);
+    }
+
+    /// Returns half of the cached objects of the class.
+    ///
+    void trim(ulen cls) {
+        FreeObject* keep=lists[cls];
+        for (ulen i=1; i<counts[cls]/2; i++)
+            keep = keep->next;
+        FreeObject* rest=keep->next;
+        keep->next = nullptr;
+        counts[cls] /= 2;
+        central[cls].give_back(cls, rest);
+    }
+};
+
+thread_local ThreadCache thread_cache;
+
+}
+
+void* ssc::SlabAllocator::alloc(ulen size) {
+    if (size > MAX_SMALL_SIZE) {
+        // Large allocations are never inside a registered slab
+        // which is how free() tells them apart.
+        void* ptr=std::malloc(size);
+        if (!ptr)
+            panic("Out of memory");
+        return ptr;
+    }
+
+    ulen cls=size_class(size);
+    if (thread_cache_destroyed) {
+        FreeObject* obj=nullptr;
+        central[cls].take(cls, 1, obj);
+        return obj;
+    }
+    ThreadCache& cache=thread_cache;
+    if (!cache.lists[cls])
+        cache.counts[cls] = central[cls].take(cls, REFILL_BATCH, cache.lists[cls]);
+    FreeObject* obj=cache.lists[cls];
+    cache.lists[cls] = obj->next;
+    --cache.counts[cls];
+    return obj;
+}
+
+void ssc::SlabAllocator::free(void* ptr) {
+    if (!ptr)
+        return;
+    Slab* slab=slab_of(ptr);
+    if (!slab_map_contains(slab)) {
+        std::free(ptr);
+        return;
+    }
+
+    ulen cls=slab->size_class;
+    FreeObject* obj=(FreeObject*) ptr;
+    if (thread_cache_destroyed) {
+        obj->next = nullptr;
+        central[cls].give_back(cls, obj);
+        return;
+    }
+    ThreadCache& cache=thread_cache;
+    obj->next = cache.lists[cls];
+    cache.lists[cls] = obj;
+    if (++cache.counts[cls] > MAX_CACHED)
+        cache.trim(cls);
 }
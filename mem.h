@@ -2,14 +2,15 @@
 #define SSC_MEM_H
 
 #include <stdlib.h>
+#include <atomic>
+#include <thread> // for std::thread::id
 
-#include "util/List.h"
+#include "core_types.h"
 #include "sys.h"
-#include "fmt.h"
 
 namespace ssc {
 
-inline bool is_power_of2(ulen v) {
+constexpr bool is_power_of2(ulen v) {
     return (v & (v-1)) == 0;
 }
 
@@ -26,23 +27,77 @@ public:
     inline void free(void* ptr) {
         return std::free(ptr);
     }
+      // Only used for trivially relocatable elements. Large
+      // blocks are mapped by malloc so on Linux resizing them
+      // remaps their pages with mremap instead of copying.
+    inline void* realloc(void* ptr, ulen old_size, ulen new_size) {
+        (void) old_size;
+        return std::realloc(ptr, new_size);
+    }
 };
 
-/// A linear allocator. Will expand allocation by chunk_size
-/// when out of memory.
+/// An allocator for objects which are constantly created and
+/// destroyed, such as IR instructions rewritten by passes.
+///
+/// Small sizes are rounded up to one of a set of size classes
+/// and served from slabs holding objects of a single class,
+/// with freed objects kept on intrusive free lists. Every thread
+/// caches free objects of each class so allocating and freeing
+/// are O(1) and do not lock. Slabs which become empty are given
+/// back to the system. Sizes above MAX_SMALL_SIZE go directly
+/// to malloc, a map of the slabs' addresses tells the two apart
+/// when freeing.
+///
+/// The allocator is a handle to a single process wide pool so
+/// it can be default constructed and copied by collections.
+///
+class SlabAllocator {
+public:
+    static constexpr ulen MAX_SMALL_SIZE=4096;
+      // Slabs are aligned to their size so that the slab of
+      // an object is found by masking its address.
+    static constexpr ulen SLAB_SIZE=1 << 16;
+
+    template<typename T>
+    T* alloc() {
+        return (T*) alloc(sizeof(T));
+    }
+
+    /// Memory is aligned to 16 bytes.
+    ///
+    void* alloc(ulen size);
+
+    void free(void* ptr);
+};
+
+/// A linear allocator which hands out memory from chunks
+/// obtained with malloc.
+///
+/// Chunks start at `chunk_size` and double in size up to
+/// `max_chunk_size` so that large phases need few calls to
+/// malloc. Requests too large for the current chunk size get
+/// a dedicated chunk and leave the current chunk in use.
 ///
-/// NOTE: free(void*) does nothing. Memory is only cleaned up once
-/// the allocator is destroyed (when it's destructor is called).
+/// NOTE: free(void*) does nothing. Memory is released all at once
+/// by rewinding to a mark, by reset() or when the allocator is
+/// destroyed. Rewinding and resetting keep the chunks around for
+/// the allocations which follow.
 ///
 class ArenaAllocator {
+    struct Chunk;
+public:
      // TODO(maddie): Is this really what the alignment should be?
-    const ulen DEFAULT_ALIGNMENT=2*sizeof(void*);
-public:   
+    static constexpr ulen DEFAULT_ALIGNMENT=2*sizeof(void*);
+    static constexpr ulen DEFAULT_MAX_CHUNK_SIZE=1 << 24;
 
-    ArenaAllocator(ulen chunk_size) :
-        chunk_size(chunk_size)
+    ArenaAllocator(ulen chunk_size, ulen max_chunk_size=DEFAULT_MAX_CHUNK_SIZE) :
+        next_chunk_size(chunk_size),
+        max_chunk_size(max_chunk_size < chunk_size ? chunk_size : max_chunk_size)
     {}
 
+    ArenaAllocator(const ArenaAllocator&) = delete;
+    ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
     template<typename T>
     T* alloc() {
         return alloc<T>(DEFAULT_ALIGNMENT);
@@ -60,40 +115,333 @@ public:
     void* alloc(ulen size, ulen align) {
         DBG_ASSERT(is_power_of2(align), "Must align on 2^n boundries");
 
-        if (!cur_chunk)
-            alloc_new_chunk();
+        uintptr_t aligned=(pos + align-1) & ~(uintptr_t)(align-1);
+        if (aligned + size > end)
+            return alloc_slow(size, align);
+        pos = aligned + size;
+        return (void*) aligned;
+    }
+
+    /// Tries to resize the memory at `ptr` from `old_size` to
+    /// `new_size` without moving it. Only possible for the most
+    /// recent allocation while its chunk has room.
+    ///
+    bool try_extend(void* ptr, ulen old_size, ulen new_size) {
+        uintptr_t start=(uintptr_t) ptr;
+        if (start + old_size != pos || start + new_size > end)
+            return false;
+        pos = start + new_size;
+        return true;
+    }
 
-        uintptr_t aligned_offset=get_aligned_offset(align);
-        uintptr_t rel_offset=aligned_offset-(uintptr_t)cur_chunk;
+    void free(void* ptr);
 
-        if (rel_offset+size > chunk_size || !cur_chunk) {
-            alloc_new_chunk();
-            // Must realign!
-            aligned_offset = get_aligned_offset(align);
-            rel_offset = aligned_offset-(uintptr_t)cur_chunk;
-        }
+    /// A position in the arena which can be rewound to.
+    ///
+    struct Mark {
+        Chunk*    chunk;
+        uintptr_t pos;
+        Chunk*    large_chunk;
+    };
 
-        offset = rel_offset + size;
-        return (void*)aligned_offset;
+    Mark mark() const {
+        return { chunks, pos, large_chunks };
     }
 
-    void free(void* ptr);
+    /// Releases everything allocated since `m` was taken. The
+    /// chunks are kept for later allocations apart from chunks
+    /// dedicated to large allocations which are freed.
+    ///
+    void rewind(const Mark& m);
+
+    /// Releases every allocation but keeps the chunks.
+    ///
+    void reset() {
+        rewind({ nullptr, 0, nullptr });
+    }
+
+    /// Frees the chunks kept by rewind() and reset().
+    ///
+    void trim();
 
     ~ArenaAllocator();
 
 private:
-    uintptr_t get_aligned_offset(ulen align);
+    struct Chunk {
+        Chunk* prev;
+        ulen   size; // bytes following the header
+    };
+
+    void* alloc_slow(ulen size, ulen align);
+    static Chunk* alloc_chunk(ulen size, Chunk* prev);
+    static void free_chunks(Chunk* chunk);
+
+      // Chunks bump allocation happens in, newest first.
+    Chunk* chunks=nullptr;
+      // Chunks dedicated to a single large allocation.
+    Chunk* large_chunks=nullptr;
+      // Chunks released by rewinding, waiting to be reused.
+    Chunk* spare_chunks=nullptr;
+
+    uintptr_t pos=0; // bump pointer into the newest chunk
+    uintptr_t end=0;
+    ulen      next_chunk_size;
+    ulen      max_chunk_size;
+};
+
+/// A linear allocator over one large range of virtual memory
+/// which is reserved up front and committed as the allocations
+/// reach it.
+///
+/// Allocations are contiguous and never move. Allocating is a
+/// bump of a pointer with a single check against the committed
+/// end, and the whole arena is reset or released at once.
+///
+/// NOTE: free(void*) does nothing, like with ArenaAllocator.
+///
+class VirtualArenaAllocator {
+public:
+    static constexpr ulen DEFAULT_ALIGNMENT=2*sizeof(void*);
+    static constexpr ulen DEFAULT_RESERVE_SIZE=sizeof(void*) == 8
+                                               ? (ulen) 1 << 36  // 64 GiB
+                                               : (ulen) 1 << 28; // 256 MiB
+      // Memory is committed in steps of this size.
+    static constexpr ulen COMMIT_SIZE=1 << 16;
+    static constexpr ulen HUGE_PAGE_SIZE=1 << 21;
+
+    using Mark = uintptr_t;
+
+    /// Reserves `reserve_size` bytes of address space. With
+    /// `huge_pages` the range is aligned and committed in steps
+    /// of huge pages and the system is asked to back it with
+    /// transparent huge pages.
+    ///
+    VirtualArenaAllocator(ulen reserve_size=DEFAULT_RESERVE_SIZE, bool huge_pages=false);
+
+    VirtualArenaAllocator(const VirtualArenaAllocator&) = delete;
+    VirtualArenaAllocator& operator=(const VirtualArenaAllocator&) = delete;
+
+    ~VirtualArenaAllocator();
+
+    template<typename T>
+    T* alloc() {
+        return alloc<T>(DEFAULT_ALIGNMENT);
+    }
+
+    template<typename T>
+    T* alloc(ulen align) {
+        return (T*) alloc(sizeof(T), align);
+    }
+
+    void* alloc(ulen size) {
+        return alloc(size, DEFAULT_ALIGNMENT);
+    }
+
+    void* alloc(ulen size, ulen align) {
+        DBG_ASSERT(is_power_of2(align), "Must align on 2^n boundries");
+
+        uintptr_t aligned=(pos + align-1) & ~(uintptr_t)(align-1);
+        if (aligned + size > committed)
+            commit(aligned + size);
+        pos = aligned + size;
+        return (void*) aligned;
+    }
+
+    /// Resizes the most recent allocation in place. Always
+    /// succeeds while there is reserved memory left.
+    ///
+    bool try_extend(void* ptr, ulen old_size, ulen new_size) {
+        uintptr_t start=(uintptr_t) ptr;
+        if (start + old_size != pos || new_size > reserved_end - start)
+            return false;
+        if (start + new_size > committed)
+            commit(start + new_size);
+        pos = start + new_size;
+        return true;
+    }
+
+    void free(void*) {
+        // Compatibility only
+    }
+
+    Mark mark() const { return pos; }
+
+    /// Releases everything allocated since `m` was taken. The
+    /// memory stays committed.
+    ///
+    void rewind(Mark m) { pos = m; }
+
+    /// Releases every allocation. The memory stays committed.
+    ///
+    void reset() { pos = base; }
+
+    /// Releases every allocation and gives the committed memory
+    /// back to the system in a single call. The address range
+    /// stays reserved.
+    ///
+    void purge();
+
+    /// Number of bytes allocated so far.
+    ///
+    ulen size() const { return pos - base; }
+
+private:
+      // Commits memory so that everything below `needed`
+      // is usable.
+    void commit(uintptr_t needed);
+
+    void*     reservation;
+    ulen      reservation_size;
+    uintptr_t base;
+    uintptr_t pos;
+    uintptr_t committed;
+    uintptr_t reserved_end;
+    ulen      commit_size;
+};
+
+/// A linear allocator which any number of threads may allocate
+/// from at once without locking.
+///
+/// Memory comes from large slabs which are shared between the
+/// threads and handed out with an atomic fetch_add. Each thread
+/// takes its own chunk of a slab and bump allocates from it
+/// without any atomic operations, so threads do not contend or
+/// share cache lines. Everything is released at once when the
+/// allocator is destroyed.
+///
+/// NOTE: free(void*) does nothing, like with ArenaAllocator.
+///
+class ConcurrentArenaAllocator {
+public:
+    static constexpr ulen DEFAULT_ALIGNMENT=2*sizeof(void*);
+    static constexpr ulen CACHE_LINE_SIZE=64;
+    static constexpr ulen DEFAULT_SLAB_SIZE=1 << 22;
+    static constexpr ulen DEFAULT_THREAD_CHUNK_SIZE=1 << 16;
+
+    ConcurrentArenaAllocator(ulen slab_size=DEFAULT_SLAB_SIZE,
+                             ulen thread_chunk_size=DEFAULT_THREAD_CHUNK_SIZE);
+
+    ConcurrentArenaAllocator(const ConcurrentArenaAllocator&) = delete;
+    ConcurrentArenaAllocator& operator=(const ConcurrentArenaAllocator&) = delete;
+
+    /// Must not be called while other threads are allocating.
+    ///
+    ~ConcurrentArenaAllocator();
 
-    inline void alloc_new_chunk() {
-        cur_chunk=std::malloc(chunk_size);
-        chunks.add(cur_chunk);
-        offset = 0;
+    template<typename T>
+    T* alloc() {
+        return alloc<T>(DEFAULT_ALIGNMENT);
     }
 
-    List<void*> chunks;
-    void* cur_chunk=nullptr;
-    ulen  offset;
-    ulen  chunk_size;
+    template<typename T>
+    T* alloc(ulen align) {
+        return (T*) alloc(sizeof(T), align);
+    }
+
+    void* alloc(ulen size) {
+        return alloc(size, DEFAULT_ALIGNMENT);
+    }
+
+    /// Allocates from the calling thread's chunk.
+    ///
+    void* alloc(ulen size, ulen align) {
+        DBG_ASSERT(is_power_of2(align), "Must align on 2^n boundries");
+
+        ThreadChunk* chunk=thread_chunk();
+        uintptr_t aligned=(chunk->pos + align-1) & ~(uintptr_t)(align-1);
+        if (aligned + size > chunk->end)
+            return alloc_slow(chunk, size, align);
+        chunk->pos = aligned + size;
+        return (void*) aligned;
+    }
+
+    /// Allocates directly from the shared slab with a single
+    /// atomic operation. Meant for small allocations made by
+    /// threads which rarely allocate from this arena.
+    ///
+    void* alloc_shared(ulen size, ulen align=DEFAULT_ALIGNMENT);
+
+    void free(void*) {
+        // Compatibility only
+    }
+
+private:
+      // Aligned so that the memory following the header is too.
+    struct alignas(DEFAULT_ALIGNMENT) Slab {
+        Slab*             prev;
+        ulen              size;
+        std::atomic<ulen> used;
+    };
+
+    struct LargeBlock {
+        LargeBlock* prev;
+    };
+
+      // Only the owning thread touches `pos` and `end`. Chunks are
+      // never removed from the list of the arena.
+    struct alignas(CACHE_LINE_SIZE) ThreadChunk {
+        uintptr_t       pos;
+        uintptr_t       end;
+        std::thread::id owner;
+        ThreadChunk*    next;
+    };
+
+      // Maps arenas to the calling thread's chunk in them. Arenas
+      // with colliding slots evict each other, after which the
+      // chunk is found again in the arena's list of chunks.
+    static constexpr ulen THREAD_CACHE_SIZE=8;
+    struct ThreadCacheEntry {
+        u64          uid;
+        ThreadChunk* chunk;
+    };
+    static thread_local ThreadCacheEntry thread_cache[THREAD_CACHE_SIZE];
+
+    ThreadChunk* thread_chunk() {
+        ThreadCacheEntry& entry=thread_cache[uid % THREAD_CACHE_SIZE];
+        if (entry.uid != uid)
+            return register_thread(entry);
+        return entry.chunk;
+    }
+
+      // Finds the calling thread's chunk, creating it the first
+      // time the thread allocates, and caches it in `entry`.
+    ThreadChunk* register_thread(ThreadCacheEntry& entry);
+    void* alloc_slow(ThreadChunk* chunk, ulen size, ulen align);
+    void* alloc_large(ulen size, ulen align);
+    Slab* install_slab(Slab* expected, ulen min_size);
+
+    static std::atomic<u64> next_uid;
+
+    const u64  uid;
+    const ulen slab_size;
+    const ulen thread_chunk_size;
+    std::atomic<Slab*>       slab;
+    std::atomic<LargeBlock*> large_blocks { nullptr };
+    std::atomic<ThreadChunk*> thread_chunks { nullptr };
+};
+
+/// Rewinds an arena to where it was when the scope was
+/// created once the scope ends.
+///
+template<typename Arena>
+class ArenaScope {
+public:
+
+    ArenaScope(Arena& arena) :
+        arena(arena),
+        m(arena.mark())
+    {}
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope() {
+        arena.rewind(m);
+    }
+
+private:
+    Arena&               arena;
+    typename Arena::Mark m;
 };
 
 }
@@ -1,42 +1,150 @@
 #include "outstream.h"
 
-#include <cstring>   // for strlen
+#include <cstring>   // for strlen, memchr, memset
 #include <algorithm>
+#include <bit>       // for std::bit_width, std::countr_zero
+#include <charconv>  // for std::to_chars
+#include <cstdlib>   // for malloc, free
+
 
 void ssc::OutStream::write(const char* buf) {
     write_buffer(buf, strlen(buf));
 }
 
+// Base-2 generates the largest number of digits which will at
+// most generate 64 plus the separators in between.
+static const ulen INT_BUF_LEN=64+21+1;
+
+static const char DIGIT_PAIRS[]=
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char DGT_SET_UPPER[]="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char DGT_SET_LOWER[]="0123456789abcdefghijklmnopqrstuvwxyz";
+
+static ulen count_digits(u64 v) {
+    static const u64 POW10[] {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+        10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+        100000000000ull, 1000000000000ull, 10000000000000ull,
+        100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+        100000000000000000ull, 1000000000000000000ull,
+        10000000000000000000ull
+    };
+    // 1233/4096 approximates log10(2) so this is either the
+    // number of digits or one more than it.
+    v |= 1; // zero still has a digit
+    ulen t=((ulen) std::bit_width(v)*1233) >> 12;
+    return t + 1 - (v < POW10[t]);
+}
+
+char* ssc::OutStream::format_u64(char* end, u64 v, ulen radix, bool lowercase, bool separators) {
+    char* ptr;
+    if (radix == 10) {
+        ptr = end - count_digits(v);
+        char* p=end;
+        while (v >= 100) {
+            ulen r=(v % 100) * 2;
+            v /= 100;
+            *--p = DIGIT_PAIRS[r+1];
+            *--p = DIGIT_PAIRS[r];
+        }
+        if (v >= 10) {
+            *--p = DIGIT_PAIRS[v*2+1];
+            *--p = DIGIT_PAIRS[v*2];
+        } else
+            *--p = (char)('0' + v);
+    } else if ((radix & (radix-1)) == 0) {
+        const char* dgt_set=lowercase ? DGT_SET_LOWER : DGT_SET_UPPER;
+        ulen shift=std::countr_zero(radix), mask=radix-1;
+        ulen bits=v ? std::bit_width(v) : 1;
+        ptr = end - (bits + shift-1) / shift;
+        for (char* p=end; p != ptr; v >>= shift)
+            *--p = dgt_set[v & mask];
+    } else {
+        const char* dgt_set=lowercase ? DGT_SET_LOWER : DGT_SET_UPPER;
+        ptr = end;
+        do {
+            *--ptr = dgt_set[v % radix];
+            v /= radix;
+        } while (v);
+    }
+
+    if (separators) {
+        // Shifting the digits to the front so that there is
+        // a separator between every group of three.
+        ulen ndigits=end-ptr;
+        char* src=ptr, *dst=ptr-(ndigits-1)/3;
+        ptr = dst;
+        for (ulen i=ndigits; i>0; i--) {
+            if (i != ndigits && i%3 == 0)
+                *dst++ = ',';
+            *dst++ = *src++;
+        }
+    }
+    return ptr;
+}
+
 void ssc::OutStream::write(u64 v, ulen radix, bool lowercase, bool separators) {
     DBG_ASSERT(radix>=2 && radix<=36, "invalid radix");
-    if (!v) {
-        write_buffer("0", 1);
+    char buf[INT_BUF_LEN];
+    char* end=buf+INT_BUF_LEN;
+    char* ptr=format_u64(end, v, radix, lowercase, separators);
+    write_buffer(ptr, end-ptr);
+}
+
+void ssc::OutStream::write(i64 v, bool include_plus, bool separators) {
+    char buf[INT_BUF_LEN+1];
+    char* end=buf+INT_BUF_LEN+1;
+    // Negating as unsigned so that the minimum value does
+    // not overflow.
+    u64 mag=v < 0 ? 0-(u64)v : (u64)v;
+    char* ptr=format_u64(end, mag, 10, false, separators);
+    if (v < 0)
+        *--ptr = '-';
+    else if (include_plus)
+        *--ptr = '+';
+    else {
+        write_buffer(ptr, end-ptr);
         return;
     }
-    const ulen BUF_LEN=64; // base-2 generates the largest number of
-                           // digits which will at most generate 64.
-    static const char DGT_SET[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    char buf[BUF_LEN];//, *ptr=buf+BUF_LEN-1;
-    ulen idx=BUF_LEN-1,count=1;
-    while (v) {
-        char c=DGT_SET[v%radix];
-        c = (lowercase && c>'9') ? c+32 : c;
-        buf[idx] = c, --idx;
-        v /= radix;     
-        if (separators && v && count%3 == 0)
-            buf[idx] = ',', --idx;
-        ++count;
+
+    ulen size=end-ptr;
+    if (fmt_info.lpad > size && fmt_info.lpad_char == '0') {
+        // Zeros go in between the sign and the digits like
+        // printf does.
+        OutPart parts[] {
+            { ptr, 1 },
+            OutPart::repeat('0', fmt_info.lpad-size),
+            { ptr+1, size-1 },
+        };
+        fmt_info.lpad = 0;
+        write_parts(parts, 3);
+        return;
     }
-    write_buffer(&buf[idx+1], BUF_LEN-idx-1);
+    // Sign and digits are written together so that padding
+    // accounts for the sign.
+    write_buffer(ptr, size);
 }
 
-void ssc::OutStream::write(i64 v, bool include_plus, bool separators) {
-    if (v<0) {
-        write_buffer("-1", 2);
-        v=-v;
-    } else if (include_plus)
-        write_buffer("+", 1);
-    write((u64) v, 10, false, separators);
+void ssc::OutStream::write(double v) {
+    char buf[32];
+    char* end=std::to_chars(buf, buf+sizeof(buf), v).ptr;
+    write_buffer(buf, end-buf);
+}
+
+void ssc::OutStream::write(float v) {
+    char buf[32];
+    char* end=std::to_chars(buf, buf+sizeof(buf), v).ptr;
+    write_buffer(buf, end-buf);
 }
 
 void ssc::OutStream::write(bool b) {
@@ -46,18 +154,173 @@ void ssc::OutStream::write(bool b) {
         write_buffer("false", 5);
 }
 
+void ssc::OutStream::write_run(const char* str, FmtRun run) {
+    const char* p=str+run.offset, *e=p+run.length;
+    if (run.escaped) {
+        // Collapsing each `%%` into a single `%`.
+        while (const char* c=(const char*) memchr(p, '%', e-p)) {
+            write_buffer(p, c-p+1);
+            p = c+2;
+        }
+    }
+    if (p != e)
+        write_buffer(p, e-p);
+}
+
+void ssc::OutStream::write_fill(char c, ulen n) {
+    OutPart part=OutPart::repeat(c, n);
+    write_parts(&part, 1);
+}
+
+void ssc::OutStream::write_parts(const OutPart* parts, ulen count) {
+    if (!fmt_info.lpad && !fmt_info.rpad) {
+        flush_parts(parts, count);
+        return;
+    }
+
+    ulen size=0;
+    for (ulen i=0; i<count; i++)
+        size += parts[i].size;
+
+    const ulen MAX_PADDED_PARTS=8;
+    if (count+2 > MAX_PADDED_PARTS) {
+        write_pad(fmt_info.lpad, fmt_info.lpad_char, size);
+        flush_parts(parts, count);
+        write_pad(fmt_info.rpad, fmt_info.rpad_char, size);
+        return;
+    }
+
+    // Surrounding the parts with the padding so that the whole
+    // field is handed over in one call.
+    OutPart padded[MAX_PADDED_PARTS];
+    ulen n=0;
+    if (fmt_info.lpad > size)
+        padded[n++] = OutPart::repeat(fmt_info.lpad_char, fmt_info.lpad-size);
+    for (ulen i=0; i<count; i++)
+        padded[n++] = parts[i];
+    if (fmt_info.rpad > size)
+        padded[n++] = OutPart::repeat(fmt_info.rpad_char, fmt_info.rpad-size);
+    fmt_info.lpad = fmt_info.rpad = 0;
+    flush_parts(padded, n);
+}
+
 void ssc::OutStream::write_pad(ulen& pad, char pad_char, ulen size) {
     if (pad>0) {
         if (pad>size)
-            for (ulen i=0; i<pad-size; i++)
-                flush_buffer(&pad_char, 1);
+            flush_fill(pad_char, pad-size);
         pad = 0;
     }
 }
 
 void ssc::OutStream::write_buffer(const char* buf, ulen size) {
-    write_pad(fmt_info.lpad, fmt_info.lpad_char, size);
-    flush_buffer(buf, size);
-    write_pad(fmt_info.rpad, fmt_info.rpad_char, size);
+    if (!fmt_info.lpad && !fmt_info.rpad) {
+        flush_buffer(buf, size);
+        return;
+    }
+    OutPart part { buf, size };
+    write_parts(&part, 1);
+}
+
+void ssc::OutStream::flush_fill(char c, ulen n) {
+    char block[64];
+    memset(block, c, n < sizeof(block) ? n : sizeof(block));
+    while (n) {
+        ulen count=n < sizeof(block) ? n : sizeof(block);
+        flush_buffer(block, count);
+        n -= count;
+    }
+}
+
+void ssc::OutStream::flush_parts(const OutPart* parts, ulen count) {
+    for (ulen i=0; i<count; i++) {
+        if (parts[i].buf)
+            flush_buffer(parts[i].buf, parts[i].size);
+        else
+            flush_fill(parts[i].fill, parts[i].size);
+    }
+}
+
+ssc::BufferedOutStream::BufferedOutStream(ulen buffer_size, BufferMode buffer_mode) :
+    buffer_mode(buffer_mode)
+{
+    set_buffer_size(buffer_size);
+}
+
+ssc::BufferedOutStream::~BufferedOutStream() {
+    std::free(buffer);
+}
+
+void ssc::BufferedOutStream::set_buffer_size(ulen size) {
+    flush();
+    std::free(buffer);
+    buffer          = size ? (char*) std::malloc(size) : nullptr;
+    buffer_capacity = buffer ? size : 0;
 }
 
+void ssc::BufferedOutStream::flush() {
+    if (buffer_size)
+        drain();
+}
+
+void ssc::BufferedOutStream::drain(const char* extra, ulen extra_size) {
+    write_out(buffer, buffer_size, extra, extra_size);
+    buffer_size = 0;
+}
+
+void ssc::BufferedOutStream::flush_buffer(const char* buf, ulen size) {
+    if (size > buffer_capacity - buffer_size) {
+        if (size >= buffer_capacity) {
+            // Would not fit even into an empty buffer so it is
+            // written directly together with the buffered output.
+            drain(buf, size);
+            return;
+        }
+        drain();
+    }
+    memcpy(buffer + buffer_size, buf, size);
+    buffer_size += size;
+    if (buffer_mode == BufferMode::Line && memchr(buf, '\n', size))
+        drain();
+}
+
+void ssc::BufferedOutStream::flush_fill(char c, ulen n) {
+    if (!buffer_capacity) {
+        OutStream::flush_fill(c, n);
+        return;
+    }
+    while (n) {
+        if (buffer_size == buffer_capacity)
+            drain();
+        ulen count=std::min(n, buffer_capacity - buffer_size);
+        memset(buffer + buffer_size, c, count);
+        buffer_size += count;
+        n -= count;
+    }
+    if (buffer_mode == BufferMode::Line && c == '\n')
+        drain();
+}
+
+void ssc::BufferedOutStream::flush_parts(const OutPart* parts, ulen count) {
+    ulen total=0;
+    for (ulen i=0; i<count; i++)
+        total += parts[i].size;
+    if (total > buffer_capacity - buffer_size) {
+        if (total > buffer_capacity) {
+            OutStream::flush_parts(parts, count);
+            return;
+        }
+        drain();
+    }
+    char* start=buffer + buffer_size;
+    char* ptr=start;
+    for (ulen i=0; i<count; i++) {
+        if (parts[i].buf)
+            memcpy(ptr, parts[i].buf, parts[i].size);
+        else
+            memset(ptr, parts[i].fill, parts[i].size);
+        ptr += parts[i].size;
+    }
+    buffer_size += total;
+    if (buffer_mode == BufferMode::Line && memchr(start, '\n', total))
+        drain();
+}
@@ -5,7 +5,8 @@
 //
 // The stream supports formatting with % being the most basic
 // character for format arguments. It behaves similarly to how
-// C's printf works.
+// C's printf works. Format strings are parsed and checked
+// against the types of the arguments at compile time.
 //
 //===---------------------------------------------------------===
 #ifndef SSC_OUTSTREAM_H
@@ -14,16 +15,187 @@
 #include <utility> // std::forward
 #include <string>
 #include <tuple>
+#include <array>
+#include <type_traits>
 
 #include "core_types.h"
 #include "characters.h"
 #include "sys.h"
+#include "util/StrSlice.h"
 
 namespace ssc {
 
+// Not constexpr on purpose. Reaching a call to this function while
+// parsing a format string at compile time turns the error message
+// into a compile error.
+inline void fmt_error([[maybe_unused]] const char* err) {}
+
+/// A span of literal characters within a format string.
+///
+struct FmtRun {
+    u32  offset;
+    u32  length;
+    bool escaped; // Contains `%%` sequences that must be collapsed.
+};
+
+/// Formatting information for a single argument of a format
+/// string:
+///
+///     %[flags][width]type
+///
+/// flags: `-` right pads, `0` left pads with zeros, `+` always
+///        writes the sign and `,` writes separators.
+/// type:  `s` writes any value, `d`, `x`, `X`, `o` and `b` write
+///        integers as decimal, hex, octal and binary.
+///
+struct FmtArgSpec {
+    u32  width=0;
+    char pad_char=' ';
+    bool right_pad=false;
+    u8   radix=10;
+    bool lowercase=true;
+    bool include_plus=false;
+    bool separators=false;
+    bool expects_int=false;
+};
+
+/// A format string which is parsed at compile time into
+/// the literal runs in between the arguments and the
+/// formatting information for each argument.
+///
+/// Construction only succeeds if the format string is valid
+/// for the types of the arguments, so writing never has to
+/// look at the format characters at runtime.
+///
+template<typename... TArgs>
+class FmtString {
+public:
+    static constexpr ulen NUM_ARGS=sizeof...(TArgs);
+
+    template<ulen N>
+    consteval FmtString(const char (&str)[N]) :
+        str(str)
+    {
+        parse(N-1);
+    }
+
+    const char* str;
+      // runs[i] comes before the i'th argument and the final
+      // run is the text after the last argument.
+    std::array<FmtRun, NUM_ARGS+1> runs {};
+    std::array<FmtArgSpec, NUM_ARGS> specs {};
+
+private:
+
+    consteval void parse(ulen len) {
+        constexpr std::array<bool, NUM_ARGS> int_args { std::is_integral_v<TArgs>... };
+
+        ulen arg_idx=0, run_start=0, i=0;
+        bool escaped=false;
+        while (i < len) {
+            if (str[i] != '%') {
+                ++i;
+                continue;
+            }
+            if (i+1 < len && str[i+1] == '%') {
+                escaped = true;
+                i += 2;
+                continue;
+            }
+            if (arg_idx == NUM_ARGS)
+                fmt_error("More format arguments than supplied arguments");
+            runs[arg_idx] = { (u32) run_start, (u32) (i-run_start), escaped };
+            ++i; // eat the %
+
+            FmtArgSpec& spec=specs[arg_idx];
+            bool fmin=false, fzero=false;
+            while (i < len) {
+                bool* flag=nullptr;
+                switch (str[i]) {
+                case '-': flag=&fmin;              break;
+                case '+': flag=&spec.include_plus; break;
+                case ',': flag=&spec.separators;   break;
+                case '0': flag=&fzero;             break;
+                }
+                if (!flag) break;
+                if (*flag) fmt_error("Duplicate format flag");
+                *flag = true, ++i;
+            }
+
+            if (fmin && fzero)
+                fmt_error("Incompatible format flags `-` and `0`");
+            if (spec.include_plus || spec.separators || fzero)
+                spec.expects_int = true;
+
+            while (i < len && is_digit(str[i])) {
+                spec.width *= 10;
+                spec.width += str[i]-'0', ++i;
+            }
+            if (fmin && !spec.width)
+                fmt_error("Missing format width with `-` flag");
+            spec.right_pad = fmin;
+            spec.pad_char  = fzero ? '0' : ' ';
+
+            switch (str[i]) { // str[len] is the null terminator
+            case 'd': spec.radix = 10; break;
+            case 'x': spec.radix = 16; break;
+            case 'X': spec.radix = 16; spec.lowercase = false; break;
+            case 'o': spec.radix = 8;  break;
+            case 'b': spec.radix = 2;  break;
+            case 's': break;
+            default:
+                fmt_error("Invalid format expected type info");
+                break;
+            }
+            if (str[i] != 's')
+                spec.expects_int = true;
+            ++i;
+
+            if (spec.include_plus && spec.radix != 10)
+                fmt_error("Format flag `+` expects decimal formatting");
+            if (spec.separators && spec.radix != 10)
+                fmt_error("Format flag `,` expects decimal formatting");
+            if (spec.expects_int && !int_args[arg_idx])
+                fmt_error("Formatting expects integer argument");
+
+            run_start = i;
+            escaped = false;
+            ++arg_idx;
+        }
+        if (arg_idx != NUM_ARGS)
+            fmt_error("Fewer format arguments than supplied arguments");
+        runs[NUM_ARGS] = { (u32) run_start, (u32) (len-run_start), escaped };
+    }
+};
+
+/// A piece of output for OutStream::write_parts. Either a
+/// buffer of characters or, when `buf` is null, `size` copies
+/// of `fill`.
+///
+struct OutPart {
+    const char* buf;
+    ulen        size;
+    char        fill=0;
+
+    static OutPart repeat(char c, ulen n) { return { nullptr, n, c }; }
+};
+
+/// The format string type for writing the given argument types.
+/// Used as a function parameter so the argument types are deduced
+/// from the arguments rather than the format string.
+///
+template<typename... TArgs>
+using FmtStr = FmtString<std::remove_cvref_t<TArgs>...>;
+
 class OutStream {
 public:
-    
+
+    virtual ~OutStream() = default;
+
+    /// Writes out any output which the stream has buffered.
+    ///
+    virtual void flush() {}
+
     void write(const char* buf);
     void write(char* buf) { write((const char*) buf); }
     void write(u64 v, ulen radix=10, bool lowercase=false, bool separators=false);
@@ -39,8 +211,29 @@ public:
         write_buffer(&c, 1);
     }
     void write(bool b);
+
+    /// Writes `n` copies of the character `c`.
+    ///
+    void write_fill(char c, ulen n);
+
+    /// Writes the parts as a single field. Padding from the
+    /// format string applies to the combined size of the parts
+    /// and the stream receives the whole field at once.
+    ///
+    void write_parts(const OutPart* parts, ulen count);
+
+      // Writes the shortest representation which parses back
+      // to the same value.
+    void write(double v);
+    void write(float v);
+    inline void write(StrSlice s) {
+        write_buffer(s.data(), s.size());
+    }
+    inline void write(std::string_view s) {
+        write_buffer(s.data(), s.size());
+    }
     inline void write(const std::string& s) {
-        write(s.c_str());
+        write_buffer(s.data(), s.size());
     }
 
       // Writing pointers
@@ -54,32 +247,16 @@ public:
 
       // Try to write using .write member function of type.
     template<typename T>
+        requires requires (T&& arg, OutStream& s) { arg.write(s); }
     inline void write(T&& arg) {
         arg.write(*this);
     }
     
-    template<typename T>
-    void write(const char* fmt, T&& arg) {
-        while (*fmt != '\0') {
-            if (*fmt == '%') {
-                write_arg(fmt, std::forward<T>(arg));
-                continue;
-            }
-            write(*fmt); // non-format character
-            ++fmt;
-        }
-    }
-
-    template<typename T, typename... TArgs>
-    void write(const char* fmt, T&& arg, TArgs&&... args) {
-        for (; *fmt != '\0'; ++fmt) {
-            if (*fmt == '%') {
-                write_arg(fmt, std::forward<T>(arg));
-                write(fmt, std::forward<TArgs>(args)...);
-                break;
-            }
-            write(*fmt); // non-format character
-        }
+    template<typename... TArgs>
+    void write(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
+        ulen idx=0;
+        (write_arg(fmt, idx++, std::forward<TArgs>(args)), ...);
+        write_run(fmt.str, fmt.runs[idx]);
     }
     
     void writeln() {
@@ -93,130 +270,53 @@ public:
     }
 
     template<typename... TArgs>
-    void writeln(const char* fmt, TArgs&&... args) {
+    void writeln(const FmtStr<TArgs...>& fmt, TArgs&&... args) {
         write(fmt, std::forward<TArgs>(args)...);
         write_buffer("\n", 1);
     }
    
 private:
 
-    void parse_digit_info(const char*& fmt,
-                          bool& lower_hex, bool& expects_int, ulen& radix) {
-                                   // a b c d  e f g h i j k l m n o p q r s t u v w x
-        static const char rdx_tab[] { 0,2,0,10,0,0,0,0,0,0,0,0,0,0,8,0,0,0,0,0,0,0,0,16 };
-        switch (*fmt) {
-        case 'd': case 'x': case 'o': case 'b':
-                  case 'X':
-            lower_hex = *fmt != 'X';
-            radix = rdx_tab[(*fmt-97u)%32];
-            ++fmt;
-            expects_int = true;
-            break;
-        case 's':
-            ++fmt;
-            break;
-        default:
-            DBG_PANIC("Invalid format expected type info");
-            break;
-        }
-    }
+    template<typename F, typename T>
+    void write_arg(const F& fmt, ulen idx, T&& arg) {
+        using NoRT=std::remove_cvref_t<T>;
 
-    template<typename T>
-    void write_arg(const char*& fmt, T&& arg) {
-    using NoRT=std::remove_reference_t<T>;
-
-    #define RD_PAD(cc, d)            \
-        fmt_info.d ## pad_char = cc; \
-        while (is_digit(*fmt)) {     \
-            fmt_info.d ## pad *= 10; \
-            fmt_info.d ## pad += (*fmt-'0'), ++fmt; }
-        
-        ++fmt; // eat the %
-        
-        // check for escape character
-        if (*fmt == '%') {
-            ++fmt;
-            write_buffer("%", 1);
-            return;
-        }
+        write_run(fmt.str, fmt.runs[idx]);
 
-        bool lower_hex=true, expects_int=false;
-        ulen radix=10;
-        
-        bool flags[]{0,0,0,0}; // format-flags
-        enum { fmin=0, fplus, fcom, fzero };
-        while (*fmt == '-' || *fmt == '+' ||
-               *fmt == ',' || *fmt == '0') {
-            ulen f=0;
-            switch (*fmt){
-            case '-': f=fmin;  break;
-            case '+': f=fplus; break;
-            case ',': f=fcom;  break;
-            case '0': f=fzero; break;
-            }
-            if (flags[f]) DBG_PANIC("Duplicate format flag");
-            else flags[f] = true, ++fmt;
-        }
-        
-        if (flags[fmin] && flags[fzero])
-            DBG_PANIC("Incompatible format flags `-` and `0`");
-        if (flags[fplus] | flags[fcom] | flags[fzero])
-            expects_int = true;
-
-        // write out old format information if it exist.
-        if (fmt_info.lpad)
-            write_pad(fmt_info.lpad, fmt_info.lpad_char, 0);
-        else if (fmt_info.rpad)
-            write_pad(fmt_info.rpad, fmt_info.rpad_char, 0);
-
-        switch (*fmt) {
-        case 'd': case 'x': case 'o': case 'b':
-                  case 'X':
-            if (flags[fmin])
-                DBG_PANIC("Missing format width with `-` flag");
-            parse_digit_info(fmt, lower_hex, expects_int, radix);
-            break;
-        case '1': case '2': case '3': case '4':
-        case '5': case '6': case '7': case '8':
-        case '9':
-            if (flags[fmin]) {
-                RD_PAD(' ', r)
-            } else if (flags[fzero]) {
-                RD_PAD('0', l)
-            } else {
-                RD_PAD(' ', l)
-            }
-            parse_digit_info(fmt, lower_hex, expects_int, radix);
-            break;
-        case 's':
-            ++fmt;
-            break;
-        default:
-            DBG_PANIC("Invalid format expected type info");
-            break;
+        const FmtArgSpec& spec=fmt.specs[idx];
+        if (spec.width) {
+            if (spec.right_pad)
+                fmt_info.rpad = spec.width, fmt_info.rpad_char = spec.pad_char;
+            else
+                fmt_info.lpad = spec.width, fmt_info.lpad_char = spec.pad_char;
         }
 
-        if (flags[fplus] && radix != 10)
-            DBG_PANIC("Format flag `+` expects decimal formatting");
-        if (flags[fcom] && radix != 10)
-            DBG_PANIC("Format flag `,` expects decimal formatting");
-
-        if constexpr (!std::is_integral_v<NoRT>)
-            if (expects_int)
-                DBG_PANIC("Formatting expects integer argument");
-
-        if constexpr (std::is_integral_v<NoRT>) {          
-            if constexpr (std::is_signed_v<NoRT>)
-                if (radix == 10)
-                    write((i64)arg, flags[fplus], flags[fcom]);
-                else
-                    write((u64) arg, radix, lower_hex, flags[fcom]);
+        if constexpr (std::is_same_v<NoRT, bool>) {
+            if (spec.expects_int)
+                write((u64) arg, spec.radix, spec.lowercase, spec.separators);
+            else
+                write(arg);
+        } else if constexpr (std::is_integral_v<NoRT>) {
+            if (std::is_same_v<NoRT, char> && !spec.expects_int)
+                write(arg);
+            else if (std::is_signed_v<NoRT> && spec.radix == 10)
+                write((i64) arg, spec.include_plus, spec.separators);
             else
-                write((u64) arg, radix, lower_hex, flags[fcom]);
+                write((u64) arg, spec.radix, spec.lowercase, spec.separators);
         } else
             write(std::forward<T>(arg));
-    #undef RD_PAD
+
+        // The argument may not have written anything in which
+        // case the padding still has to be written.
+        write_pad(fmt_info.lpad, fmt_info.lpad_char, 0);
+        write_pad(fmt_info.rpad, fmt_info.rpad_char, 0);
     }
+
+    void write_run(const char* str, FmtRun run);
+
+      // Writes the digits of `v` backwards ending at `end` and
+      // returns the first digit.
+    static char* format_u64(char* end, u64 v, ulen radix, bool lowercase, bool separators);
  
     struct FmtInfo {
         // left pad  '   foo'
@@ -234,6 +334,68 @@ protected:
 
     virtual void flush_buffer(const char* buf, ulen size) = 0;
 
+      // Streams which can fill memory directly should override
+      // these. The defaults fall back to flush_buffer.
+    virtual void flush_fill(char c, ulen n);
+    virtual void flush_parts(const OutPart* parts, ulen count);
+
+};
+
+/// A stream which collects output into a block of memory and
+/// only hands it to write_out() once the block is full, when
+/// flush() is called, or after every new line when the stream
+/// is line buffered.
+///
+class BufferedOutStream : public OutStream {
+public:
+
+    enum class BufferMode {
+        Full, // Drains only once the buffer is full.
+        Line  // Also drains after writing a new line.
+    };
+
+    BufferedOutStream(ulen buffer_size, BufferMode buffer_mode=BufferMode::Full);
+
+    BufferedOutStream(const BufferedOutStream&) = delete;
+    BufferedOutStream& operator=(const BufferedOutStream&) = delete;
+
+      // Derived streams must flush in their own destructor since
+      // write_out() cannot be called from here.
+    ~BufferedOutStream();
+
+    /// Writes all the buffered output.
+    ///
+    void flush() override;
+
+    /// Flushes the stream and replaces its buffer with a buffer
+    /// of the given size. A size of 0 makes the stream unbuffered.
+    ///
+    void set_buffer_size(ulen size);
+
+    void set_buffer_mode(BufferMode mode) { buffer_mode = mode; }
+    BufferMode get_buffer_mode() const { return buffer_mode; }
+
+    /// Number of characters waiting in the buffer.
+    ///
+    ulen buffered_size() const { return buffer_size; }
+
+protected:
+    void flush_buffer(const char* buf, ulen size) override;
+    void flush_fill(char c, ulen n) override;
+    void flush_parts(const OutPart* parts, ulen count) override;
+
+      // Writes the buffered output followed by `extra`. `extra`
+      // is only given for writes too large for the buffer.
+    virtual void write_out(const char* buf, ulen size,
+                           const char* extra, ulen extra_size) = 0;
+
+private:
+    void drain(const char* extra=nullptr, ulen extra_size=0);
+
+    char*      buffer=nullptr;
+    ulen       buffer_capacity=0;
+    ulen       buffer_size=0;
+    BufferMode buffer_mode;
 };
 
 }
@@ -0,0 +1,237 @@
+#include "simd.h"
+
+#include <bit> // for std::countr_zero, std::popcount
+
+#if SSC_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace ssc {
+
+bool cpu_has_avx2() {
+#if SSC_SIMD_X86
+#ifdef _MSC_VER
+    static const bool has_avx2=[] {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        // The system has to save the YMM registers on context
+        // switches, shown by OSXSAVE and the SSE and AVX state
+        // bits of XCR0.
+        __cpuid(info, 1);
+        if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+#else
+    static const bool has_avx2=__builtin_cpu_supports("avx2");
+#endif
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+namespace {
+
+template<typename U>
+ulen find_scalar(const U* elms, ulen i, ulen count, U v) {
+    for (; i < count; ++i)
+        if (elms[i] == v)
+            return i;
+    return count;
+}
+
+template<typename U>
+ulen count_scalar(const U* elms, ulen i, ulen count, U v) {
+    ulen n=0;
+    for (; i < count; ++i)
+        n += elms[i] == v;
+    return n;
+}
+
+#if SSC_SIMD_X86
+
+  // Compares each lane of `a` to `b` and gets one bit per byte
+  // of the lanes that are equal.
+template<typename U>
+u32 match_sse2(__m128i a, __m128i b) {
+    __m128i eq;
+    if constexpr (sizeof(U) == 1)
+        eq=_mm_cmpeq_epi8(a, b);
+    else if constexpr (sizeof(U) == 2)
+        eq=_mm_cmpeq_epi16(a, b);
+    else if constexpr (sizeof(U) == 4)
+        eq=_mm_cmpeq_epi32(a, b);
+    else {
+        // SSE2 has no 64 bit compare so both halves must match.
+        __m128i eq32=_mm_cmpeq_epi32(a, b);
+        eq=_mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    return (u32) _mm_movemask_epi8(eq);
+}
+
+template<typename U>
+__m128i splat_sse2(U v) {
+    if constexpr (sizeof(U) == 1)
+        return _mm_set1_epi8((char) v);
+    else if constexpr (sizeof(U) == 2)
+        return _mm_set1_epi16((short) v);
+    else if constexpr (sizeof(U) == 4)
+        return _mm_set1_epi32((int) v);
+    else
+        return _mm_set1_epi64x((long long) v);
+}
+
+template<typename U>
+SSC_TARGET_AVX2 u32 match_avx2(__m256i a, __m256i b) {
+    __m256i eq;
+    if constexpr (sizeof(U) == 1)
+        eq=_mm256_cmpeq_epi8(a, b);
+    else if constexpr (sizeof(U) == 2)
+        eq=_mm256_cmpeq_epi16(a, b);
+    else if constexpr (sizeof(U) == 4)
+        eq=_mm256_cmpeq_epi32(a, b);
+    else
+        eq=_mm256_cmpeq_epi64(a, b);
+    return (u32) _mm256_movemask_epi8(eq);
+}
+
+template<typename U>
+SSC_TARGET_AVX2 __m256i splat_avx2(U v) {
+    if constexpr (sizeof(U) == 1)
+        return _mm256_set1_epi8((char) v);
+    else if constexpr (sizeof(U) == 2)
+        return _mm256_set1_epi16((short) v);
+    else if constexpr (sizeof(U) == 4)
+        return _mm256_set1_epi32((int) v);
+    else
+        return _mm256_set1_epi64x((long long) v);
+}
+
+template<typename U>
+ulen find_sse2(const U* elms, ulen count, U v) {
+    constexpr ulen LANES=16/sizeof(U);
+    __m128i needle=splat_sse2(v);
+    ulen i=0;
+    for (; i+LANES <= count; i += LANES) {
+        __m128i block=_mm_loadu_si128((const __m128i*) (elms+i));
+        if (u32 mask=match_sse2<U>(block, needle))
+            return i + std::countr_zero(mask)/sizeof(U);
+    }
+    return find_scalar(elms, i, count, v);
+}
+
+template<typename U>
+ulen count_sse2(const U* elms, ulen count, U v) {
+    constexpr ulen LANES=16/sizeof(U);
+    __m128i needle=splat_sse2(v);
+    ulen n=0;
+    ulen i=0;
+    for (; i+LANES <= count; i += LANES) {
+        __m128i block=_mm_loadu_si128((const __m128i*) (elms+i));
+        n += std::popcount(match_sse2<U>(block, needle));
+    }
+    return n/sizeof(U) + count_scalar(elms, i, count, v);
+}
+
+template<typename U>
+SSC_TARGET_AVX2 ulen find_avx2(const U* elms, ulen count, U v) {
+    constexpr ulen LANES=32/sizeof(U);
+    __m256i needle=splat_avx2(v);
+    ulen i=0;
+    for (; i+LANES <= count; i += LANES) {
+        __m256i block=_mm256_loadu_si256((const __m256i*) (elms+i));
+        if (u32 mask=match_avx2<U>(block, needle))
+            return i + std::countr_zero(mask)/sizeof(U);
+    }
+    return find_scalar(elms, i, count, v);
+}
+
+template<typename U>
+SSC_TARGET_AVX2 ulen count_avx2(const U* elms, ulen count, U v) {
+    constexpr ulen LANES=32/sizeof(U);
+    __m256i needle=splat_avx2(v);
+    ulen n=0;
+    ulen i=0;
+    for (; i+LANES <= count; i += LANES) {
+        __m256i block=_mm256_loadu_si256((const __m256i*) (elms+i));
+        n += std::popcount(match_avx2<U>(block, needle));
+    }
+    return n/sizeof(U) + count_scalar(elms, i, count, v);
+}
+
+template<typename U>
+ulen find_dispatch(const U* elms, ulen count, U v) {
+    if (cpu_has_avx2())
+        return find_avx2(elms, count, v);
+    return find_sse2(elms, count, v);
+}
+
+template<typename U>
+ulen count_dispatch(const U* elms, ulen count, U v) {
+    if (cpu_has_avx2())
+        return count_avx2(elms, count, v);
+    return count_sse2(elms, count, v);
+}
+
+template<typename U>
+ulen find_baseline(const U* elms, ulen count, U v) {
+    return find_sse2(elms, count, v);
+}
+
+template<typename U>
+ulen count_baseline(const U* elms, ulen count, U v) {
+    return count_sse2(elms, count, v);
+}
+
+#else
+
+template<typename U>
+ulen find_dispatch(const U* elms, ulen count, U v) {
+    return find_scalar(elms, 0, count, v);
+}
+
+template<typename U>
+ulen count_dispatch(const U* elms, ulen count, U v) {
+    return count_scalar(elms, 0, count, v);
+}
+
+template<typename U>
+ulen find_baseline(const U* elms, ulen count, U v) {
+    return find_scalar(elms, 0, count, v);
+}
+
+template<typename U>
+ulen count_baseline(const U* elms, ulen count, U v) {
+    return count_scalar(elms, 0, count, v);
+}
+
+#endif
+}
+
+ulen simd_find(const u8* elms, ulen count, u8 v)    { return find_dispatch(elms, count, v); }
+ulen simd_find(const u16* elms, ulen count, u16 v)  { return find_dispatch(elms, count, v); }
+ulen simd_find(const u32* elms, ulen count, u32 v)  { return find_dispatch(elms, count, v); }
+ulen simd_find(const u64* elms, ulen count, u64 v)  { return find_dispatch(elms, count, v); }
+
+ulen simd_count(const u8* elms, ulen count, u8 v)   { return count_dispatch(elms, count, v); }
+ulen simd_count(const u16* elms, ulen count, u16 v) { return count_dispatch(elms, count, v); }
+ulen simd_count(const u32* elms, ulen count, u32 v) { return count_dispatch(elms, count, v); }
+ulen simd_count(const u64* elms, ulen count, u64 v) { return count_dispatch(elms, count, v); }
+
+ulen simd_find_baseline(const u8* elms, ulen count, u8 v)    { return find_baseline(elms, count, v); }
+ulen simd_find_baseline(const u16* elms, ulen count, u16 v)  { return find_baseline(elms, count, v); }
+ulen simd_find_baseline(const u32* elms, ulen count, u32 v)  { return find_baseline(elms, count, v); }
+ulen simd_find_baseline(const u64* elms, ulen count, u64 v)  { return find_baseline(elms, count, v); }
+
+ulen simd_count_baseline(const u8* elms, ulen count, u8 v)   { return count_baseline(elms, count, v); }
+ulen simd_count_baseline(const u16* elms, ulen count, u16 v) { return count_baseline(elms, count, v); }
+ulen simd_count_baseline(const u32* elms, ulen count, u32 v) { return count_baseline(elms, count, v); }
+ulen simd_count_baseline(const u64* elms, ulen count, u64 v) { return count_baseline(elms, count, v); }
+}
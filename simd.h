@@ -0,0 +1,64 @@
+//===---------------------------------------------------------===
+//
+// Vectorized kernels over arrays of plain integers which pick
+// the widest instruction set the processor supports at runtime.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_SIMD_H
+#define SSC_SIMD_H
+
+#include "core_types.h"
+
+namespace ssc {
+
+  // SSE2 is only assumed where it is part of the base instruction set.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SSC_SIMD_X86 1
+#else
+#define SSC_SIMD_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SSC_TARGET_AVX2
+#else
+  // Allows using AVX2 intrinsics in a function without compiling
+  // the whole program for AVX2.
+#define SSC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/// Whether the processor supports AVX2. Checked once.
+///
+bool cpu_has_avx2();
+
+/// Get the index of the first element equal to `v`.
+///
+/// \return `count` if no element is equal.
+///
+ulen simd_find(const u8* elms, ulen count, u8 v);
+ulen simd_find(const u16* elms, ulen count, u16 v);
+ulen simd_find(const u32* elms, ulen count, u32 v);
+ulen simd_find(const u64* elms, ulen count, u64 v);
+
+/// Get the number of elements equal to `v`.
+///
+ulen simd_count(const u8* elms, ulen count, u8 v);
+ulen simd_count(const u16* elms, ulen count, u16 v);
+ulen simd_count(const u32* elms, ulen count, u32 v);
+ulen simd_count(const u64* elms, ulen count, u64 v);
+
+/// simd_find and simd_count without AVX2, which is what they do
+/// on processors without it. Lets the two be checked against
+/// each other on any processor.
+///
+ulen simd_find_baseline(const u8* elms, ulen count, u8 v);
+ulen simd_find_baseline(const u16* elms, ulen count, u16 v);
+ulen simd_find_baseline(const u32* elms, ulen count, u32 v);
+ulen simd_find_baseline(const u64* elms, ulen count, u64 v);
+
+ulen simd_count_baseline(const u8* elms, ulen count, u8 v);
+ulen simd_count_baseline(const u16* elms, ulen count, u16 v);
+ulen simd_count_baseline(const u32* elms, ulen count, u32 v);
+ulen simd_count_baseline(const u64* elms, ulen count, u64 v);
+}
+
+#endif
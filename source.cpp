@@ -0,0 +1,236 @@
+#include "source.h"
+#include "characters.h"
+
+#include <cstring> // for memcpy, memset, strlen
+#include <cstdio>
+#include <cstdlib> // for malloc, realloc, free
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ssc {
+
+static constexpr ulen SOURCE_CHUNK_SIZE=1 << 20;
+
+#ifndef _WIN32
+static ulen mapping_size(ulen size) {
+    static const ulen page_size=(ulen) sysconf(_SC_PAGESIZE);
+    return (size + SourceManager::PADDING + page_size-1) & ~(page_size-1);
+}
+#endif
+
+SourceManager::SourceManager() :
+    arena(SOURCE_CHUNK_SIZE)
+{}
+
+SourceManager::~SourceManager() {
+#ifndef _WIN32
+    for (const SourceFile& file : files)
+        if (file.mapped)
+            munmap((void*) file.data, mapping_size(file.size));
+#endif
+}
+
+const SourceFile* SourceManager::load(const char* path) {
+    ulen size=0;
+    bool mapped=true;
+    const char* data=map_file(path, size);
+    if (!data) {
+        mapped=false;
+        data=read_file(path, size);
+        if (!data)
+            return nullptr;
+    }
+    ulen path_size=strlen(path);
+    char* path_copy=(char*) arena.alloc(path_size+1, 1);
+    memcpy(path_copy, path, path_size+1);
+    return add_file(StrSlice(path_copy, path_size), data, size, mapped);
+}
+
+const SourceFile* SourceManager::add_buffer(StrSlice name, StrSlice contents) {
+    char* data=(char*) arena.alloc(contents.size() + PADDING);
+    memcpy(data, contents.data(), contents.size());
+    memset(data + contents.size(), 0, PADDING);
+    char* name_copy=(char*) arena.alloc(name.size()+1, 1);
+    memcpy(name_copy, name.data(), name.size());
+    name_copy[name.size()]='\0';
+    return add_file(StrSlice(name_copy, name.size()), data, contents.size(), false);
+}
+
+const SourceFile* SourceManager::add_file(StrSlice path, const char* data, ulen size, bool mapped) {
+    // Every file takes its size plus one offsets.
+    if (size >= UINT32_MAX - next_offset)
+        panic("sources exceed the 4GiB offset space");
+    SourceFile& file=files.emplace();
+    file.path   = path;
+    file.data   = data;
+    file.size   = (u32) size;
+    file.start  = next_offset;
+    file.utf8   = check_utf8(data, size);
+    file.mapped = mapped;
+    next_offset += (u32) size + 1;
+    return &file;
+}
+
+const SourceFile* SourceManager::file_of(SourceOffset offset) const {
+    // Finding the last file starting at or before the offset.
+    ulen lo=0, hi=files.size();
+    while (lo < hi) {
+        ulen mid=lo + (hi-lo)/2;
+        if (files[mid].start <= offset)
+            lo=mid+1;
+        else
+            hi=mid;
+    }
+    if (lo == 0 || !files[lo-1].contains(offset))
+        return nullptr;
+    return &files[lo-1];
+}
+
+const List<u32>& SourceFile::lines() const {
+    std::call_once(lines_once, [this] {
+        line_starts.add(0);
+        const char* end=data + size;
+        for (const char* p=find_newline(data, end); p != end; p=find_newline(p+1, end))
+            line_starts.add((u32) (p+1 - data));
+    });
+    return line_starts;
+}
+
+void LineCol::write(OutStream& s) const {
+    if (!file) {
+        s.write("<unknown>");
+        return;
+    }
+    s.write("%s:%s:%s", file->path, line, column);
+}
+
+LineCol SourceManager::line_col(SourceLoc loc) const {
+    const SourceFile* file=file_of(loc);
+    if (!file)
+        return LineCol{};
+    const List<u32>& lines=file->lines();
+    u32 offset=loc - file->start;
+
+    // Finding the last line starting at or before the offset.
+    ulen lo=0, hi=lines.size();
+    while (lo < hi) {
+        ulen mid=lo + (hi-lo)/2;
+        if (lines[mid] <= offset)
+            lo=mid+1;
+        else
+            hi=mid;
+    }
+    u32 line_start=lines[lo-1];
+    // The byte order mark is not part of the first line.
+    if (lo == 1)
+        line_start=(u32) file->utf8.bom_size;
+    u32 column=offset >= line_start ? offset - line_start + 1 : 1;
+    return LineCol{ file, (u32) lo, column };
+}
+
+const char* SourceManager::map_file(const char* path, ulen& size) {
+#ifdef _WIN32
+    // Mapping is only implemented on POSIX systems.
+    return nullptr;
+#else
+    int fd=::open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size=(ulen) st.st_size;
+
+    // Reserving zeroed pages for the contents and the padding then
+    // mapping the file over the start of them. The rest of the last
+    // page of the file is zero filled by the system.
+    ulen total=mapping_size(size);
+    void* base=mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+    void* ptr=mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        munmap(base, total);
+        return nullptr;
+    }
+    return (const char*) ptr;
+#endif
+}
+
+char* SourceManager::read_file(const char* path, ulen& size) {
+    FILE* f=fopen(path, "rb");
+    if (!f)
+        return nullptr;
+
+    // Only the size of a regular file can be trusted, pipes and
+    // files such as those under /proc report a size of 0.
+    bool known_size=false;
+    size=0;
+#ifndef _WIN32
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size=(ulen) st.st_size;
+        known_size=true;
+    }
+#else
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long end=ftell(f);
+        if (end > 0) {
+            size=(ulen) end;
+            known_size=true;
+        }
+        fseek(f, 0, SEEK_SET);
+    }
+#endif
+
+    if (known_size) {
+        char* data=(char*) arena.alloc(size + PADDING);
+        ulen read=fread(data, 1, size, f);
+        fclose(f);
+        if (read != size)
+            return nullptr;
+        memset(data + size, 0, PADDING);
+        return data;
+    }
+
+    // Reading until the end into a buffer which doubles as it
+    // fills, then copying it into the arena with the padding.
+    ulen capacity=1 << 16;
+    char* buffer=(char*) std::malloc(capacity);
+    if (!buffer)
+        panic("Out of memory");
+    for (;;) {
+        size += fread(buffer + size, 1, capacity - size, f);
+        if (size < capacity)
+            break;
+        capacity *= 2;
+        char* grown=(char*) std::realloc(buffer, capacity);
+        if (!grown)
+            panic("Out of memory");
+        buffer=grown;
+    }
+    bool failed=ferror(f) != 0;
+    fclose(f);
+    if (failed) {
+        std::free(buffer);
+        return nullptr;
+    }
+    char* data=(char*) arena.alloc(size + PADDING);
+    memcpy(data, buffer, size);
+    memset(data + size, 0, PADDING);
+    std::free(buffer);
+    return data;
+}
+}
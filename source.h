@@ -0,0 +1,148 @@
+//===---------------------------------------------------------===
+//
+// Loads source files and gives every byte of every file a
+// single 32-bit offset.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_SOURCE_H
+#define SSC_SOURCE_H
+
+#include <mutex> // for std::once_flag
+
+#include "mem.h"
+#include "utf8.h"
+#include "outstream.h"
+#include "util/List.h"
+#include "util/BucketList.h"
+#include "util/StrSlice.h"
+
+namespace ssc {
+
+/// An offset into the space shared by all the sources of a
+/// SourceManager. Offset 0 is never part of a source.
+///
+using SourceOffset = u32;
+
+/// The location of a token or IR node, which is just its
+/// offset. Lines and columns are only worked out when
+/// a location is reported.
+///
+using SourceLoc = SourceOffset;
+
+/// A file loaded by a SourceManager.
+///
+struct SourceFile {
+    StrSlice     path;
+      // The contents, followed by SourceManager::PADDING
+      // zero bytes.
+    const char*  data;
+    u32          size;
+      // The offset of the first byte. The offset just past the
+      // last byte also belongs to the file so the end of the
+      // file has a location.
+    SourceOffset start;
+      // The result of validating the contents as UTF-8 which
+      // includes the size of a byte order mark to skip.
+    Utf8Check    utf8;
+    bool         mapped;
+
+    SourceOffset end() const { return start + size; }
+
+    bool contains(SourceOffset offset) const {
+        return offset >= start && offset <= end();
+    }
+
+    /// Get the contents of the file.
+    ///
+    StrSlice contents() const { return StrSlice(data, size); }
+
+    /// Get the offset within the file at which each line starts,
+    /// found the first time lines are needed.
+    ///
+    const List<u32>& lines() const;
+
+private:
+    mutable List<u32>      line_starts;
+    mutable std::once_flag lines_once;
+};
+
+/// A location as a line and column, both starting from 1.
+/// Columns count bytes.
+///
+struct LineCol {
+    const SourceFile* file=nullptr;
+    u32               line=0;
+    u32               column=0;
+
+    /// Writes the location as `path:line:column`.
+    ///
+    void write(OutStream& s) const;
+};
+
+/// Owns the contents of all the source files of a compilation.
+///
+/// Files are memory mapped where possible so loading a file costs
+/// a mapping rather than a copy, and are otherwise read into an
+/// arena. Either way the contents are followed by PADDING zero
+/// bytes so the lexer can read ahead, even whole vectors at a
+/// time, without checking for the end.
+///
+/// The contents stay at the same address until the manager is
+/// destroyed so tokens can refer to them without copying.
+///
+class SourceManager {
+public:
+    static constexpr ulen PADDING=64;
+
+    SourceManager();
+    ~SourceManager();
+
+    SourceManager(const SourceManager&) = delete;
+    SourceManager& operator=(const SourceManager&) = delete;
+
+    /// Loads the file at `path`. Files without a size known up
+    /// front, such as pipes, are read until their end.
+    ///
+    /// \return nullptr if the file could not be read.
+    ///
+    const SourceFile* load(const char* path);
+
+    /// Adds a source held in memory, such as one generated by the
+    /// compiler, by copying it. `name` stands in for the path.
+    ///
+    const SourceFile* add_buffer(StrSlice name, StrSlice contents);
+
+    /// Get the file which an offset is part of.
+    ///
+    /// \return nullptr if no file contains the offset.
+    ///
+    const SourceFile* file_of(SourceOffset offset) const;
+
+    /// Get the line and column of a location. The lines of the
+    /// file are found the first time one of its locations is
+    /// looked up, after which it is a binary search.
+    ///
+    /// \return a LineCol without a file if no file contains
+    /// the location.
+    ///
+    LineCol line_col(SourceLoc loc) const;
+
+    /// Get the number of files loaded.
+    ///
+    ulen file_count() const { return files.size(); }
+
+    const SourceFile& file(ulen idx) const { return files[idx]; }
+
+private:
+      // Gives the file the next range of offsets.
+    const SourceFile* add_file(StrSlice path, const char* data, ulen size, bool mapped);
+    char* read_file(const char* path, ulen& size);
+    const char* map_file(const char* path, ulen& size);
+
+    ArenaAllocator         arena;
+    BucketList<SourceFile> files;
+    SourceOffset           next_offset=1;
+};
+}
+
+#endif
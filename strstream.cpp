@@ -0,0 +1,112 @@
+#include "strstream.h"
+
+#include <cstring> // for memcpy, memset
+
+// Copies the parts one after the other starting at `dst`.
+static void copy_parts(char* dst, const ssc::OutPart* parts, ulen count) {
+    for (ulen i=0; i<count; i++) {
+        if (parts[i].buf)
+            memcpy(dst, parts[i].buf, parts[i].size);
+        else
+            memset(dst, parts[i].fill, parts[i].size);
+        dst += parts[i].size;
+    }
+}
+
+static ulen parts_size(const ssc::OutPart* parts, ulen count) {
+    ulen size=0;
+    for (ulen i=0; i<count; i++)
+        size += parts[i].size;
+    return size;
+}
+
+const char* ssc::StringOutStream::c_str() {
+    // Adding then removing the terminator keeps it in
+    // the memory past the end of the list.
+    buffer->add('\0');
+    buffer->pop_back();
+    return buffer->begin();
+}
+
+void ssc::StringOutStream::flush_buffer(const char* buf, ulen size) {
+    ulen old_size=buffer->size();
+    buffer->resize(old_size + size);
+    memcpy(buffer->begin() + old_size, buf, size);
+}
+
+void ssc::StringOutStream::flush_fill(char c, ulen n) {
+    ulen old_size=buffer->size();
+    buffer->resize(old_size + n);
+    memset(buffer->begin() + old_size, c, n);
+}
+
+void ssc::StringOutStream::flush_parts(const OutPart* parts, ulen count) {
+    ulen old_size=buffer->size();
+    buffer->resize(old_size + parts_size(parts, count));
+    copy_parts(buffer->begin() + old_size, parts, count);
+}
+
+const char* ssc::ArenaOutStream::take() {
+    reserve(len + 1);
+    buf[len] = '\0';
+    const char* str=buf;
+    // The remaining capacity is given up since the string
+    // now belongs to the caller.
+    buf = nullptr;
+    len = capacity = 0;
+    return str;
+}
+
+void ssc::ArenaOutStream::reserve(ulen size) {
+    if (size <= capacity)
+        return;
+    ulen new_capacity=capacity ? capacity : initial_capacity;
+    while (new_capacity < size)
+        new_capacity <<= 1;
+    // Most of the time the buffer is the newest allocation of
+    // the arena and can grow without being copied.
+    if (buf && arena.try_extend(buf, capacity, new_capacity)) {
+        capacity = new_capacity;
+        return;
+    }
+    char* new_buf=(char*) arena.alloc(new_capacity, 1);
+    if (len)
+        memcpy(new_buf, buf, len);
+    buf      = new_buf;
+    capacity = new_capacity;
+}
+
+void ssc::ArenaOutStream::flush_buffer(const char* data, ulen size) {
+    reserve(len + size);
+    memcpy(buf + len, data, size);
+    len += size;
+}
+
+void ssc::ArenaOutStream::flush_fill(char c, ulen n) {
+    reserve(len + n);
+    memset(buf + len, c, n);
+    len += n;
+}
+
+void ssc::ArenaOutStream::flush_parts(const OutPart* parts, ulen count) {
+    ulen size=parts_size(parts, count);
+    reserve(len + size);
+    copy_parts(buf + len, parts, count);
+    len += size;
+}
+
+void ssc::FixedOutStream::flush_buffer(const char* data, ulen size) {
+    if (total_len < capacity) {
+        ulen n=capacity-total_len < size ? capacity-total_len : size;
+        memcpy(buf + total_len, data, n);
+    }
+    total_len += size;
+}
+
+void ssc::FixedOutStream::flush_fill(char c, ulen n) {
+    if (total_len < capacity) {
+        ulen count=capacity-total_len < n ? capacity-total_len : n;
+        memset(buf + total_len, c, count);
+    }
+    total_len += n;
+}
@@ -0,0 +1,157 @@
+//===---------------------------------------------------------===
+//
+// Output streams which write into memory rather than to the
+// console. Used for building names, labels and messages with
+// the same formatting as the rest of the output.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_STRSTREAM_H
+#define SSC_STRSTREAM_H
+
+#include "outstream.h"
+#include "util/List.h"
+
+namespace ssc {
+
+/// A stream which writes into a growable List<char>.
+///
+/// The stream either owns its list or appends onto an
+/// existing list.
+///
+class StringOutStream : public OutStream {
+public:
+
+    StringOutStream() :
+        buffer(&owned)
+    {}
+
+    /// Creates a stream which appends to `target`.
+    ///
+    explicit StringOutStream(List<char>& target) :
+        buffer(&target)
+    {}
+
+    StringOutStream(const StringOutStream&) = delete;
+    StringOutStream& operator=(const StringOutStream&) = delete;
+
+    const char* data() const { return buffer->begin(); }
+    ulen size() const { return buffer->size(); }
+    bool empty() const { return buffer->empty(); }
+
+    /// Get the written characters as a null terminated
+    /// string. The string is valid until the next write.
+    ///
+    const char* c_str();
+
+    std::string to_string() const {
+        return std::string(data(), size());
+    }
+
+    List<char>& list() { return *buffer; }
+
+    /// Removes the written characters but keeps the memory.
+    ///
+    void clear() { buffer->clear(); }
+
+protected:
+    void flush_buffer(const char* buf, ulen size) override;
+    void flush_fill(char c, ulen n) override;
+    void flush_parts(const OutPart* parts, ulen count) override;
+
+private:
+    List<char>  owned;
+    List<char>* buffer;
+};
+
+/// A stream which writes into memory obtained from an arena.
+///
+/// The written strings live for as long as the arena does
+/// which makes this useful for names which are kept around
+/// for the rest of compilation.
+///
+class ArenaOutStream : public OutStream {
+public:
+
+    ArenaOutStream(ArenaAllocator& arena, ulen initial_capacity=64) :
+        arena(arena),
+        initial_capacity(initial_capacity)
+    {}
+
+    ArenaOutStream(const ArenaOutStream&) = delete;
+    ArenaOutStream& operator=(const ArenaOutStream&) = delete;
+
+    const char* data() const { return buf; }
+    ulen size() const { return len; }
+
+    /// Null terminates and returns the current string then
+    /// starts a new one. The returned string stays valid until
+    /// the arena is destroyed.
+    ///
+    const char* take();
+
+protected:
+    void flush_buffer(const char* buf, ulen size) override;
+    void flush_fill(char c, ulen n) override;
+    void flush_parts(const OutPart* parts, ulen count) override;
+
+private:
+    void reserve(ulen size);
+
+    ArenaAllocator& arena;
+    ulen  initial_capacity;
+    char* buf=nullptr;
+    ulen  len=0;
+    ulen  capacity=0;
+};
+
+/// A stream which writes into a fixed size buffer without
+/// allocating. Output past the end of the buffer is dropped
+/// but still counted.
+///
+class FixedOutStream : public OutStream {
+public:
+
+    FixedOutStream(char* buf, ulen capacity) :
+        buf(buf),
+        capacity(capacity)
+    {}
+
+    /// Number of characters written into the buffer.
+    ///
+    ulen size() const { return total_len < capacity ? total_len : capacity; }
+
+    /// Number of characters the output would have had if
+    /// the buffer were large enough.
+    ///
+    ulen total_size() const { return total_len; }
+
+    bool truncated() const { return total_len > capacity; }
+
+protected:
+    void flush_buffer(const char* buf, ulen size) override;
+    void flush_fill(char c, ulen n) override;
+
+private:
+    char* buf;
+    ulen  capacity;
+    ulen  total_len=0;
+};
+
+/// Formats into the buffer `buf` of size `n` and null terminates
+/// it, truncating the output if it does not fit. Never allocates.
+///
+/// \return the length the output would have had, so the output
+///         was truncated if the return value is >= n.
+///
+template<typename... TArgs>
+ulen format_to(char* buf, ulen n, const FmtStr<TArgs...>& fmt, TArgs&&... args) {
+    FixedOutStream stream(buf, n ? n-1 : 0);
+    stream.write(fmt, std::forward<TArgs>(args)...);
+    if (n)
+        buf[stream.size()] = '\0';
+    return stream.total_size();
+}
+
+}
+
+#endif
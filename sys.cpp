@@ -1,13 +1,19 @@
 #include "sys.h"
 
 #include "fmt.h"
+#include "diag.h"
 
 #ifdef _WIN32
 #include <Windows.h>
 #include <dbghelp.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h> // for writev
+#include <errno.h>
 #endif
 
 #include <string>
+#include <cstring> // for strlen, strcmp
 #include <algorithm>
 
 static bool PREVENT_CIRCULAR = false;
@@ -76,9 +82,63 @@ void ssc::panic(const char* err, char exit_code) {
     if (PREVENT_CIRCULAR)
         exit(255);
     PREVENT_CIRCULAR = true;
+    // Making sure the output leading up to the panic appears
+    // before the panic message.
+    stdout_stream.flush();
+    diag_stream().commit();
+    flush_diagnostics();
     eprintln("\nPanic Termination");
     try_stacktrace();
     eprintln(">> Reason: %s", err);
+    flush_std_streams();
     exit(exit_code);
 }
 
+
+#ifdef _WIN32
+  // WriteFile takes a 32 bit size and may write less
+  // than it was given.
+static bool write_file(HANDLE file, const char* buf, ulen size) {
+    while (size) {
+        DWORD chunk=size > MAXDWORD ? MAXDWORD : (DWORD) size;
+        DWORD written;
+        if (!WriteFile(file, buf, chunk, &written, nullptr) || written == 0)
+            return false;
+        buf  += written;
+        size -= written;
+    }
+    return true;
+}
+#endif
+
+bool ssc::write_all(FileHandle file, const char* buf, ulen size,
+                    const char* extra, ulen extra_size) {
+#ifdef _WIN32
+    return write_file(file, buf, size) && write_file(file, extra, extra_size);
+#else
+    iovec iov[2] {
+        { (void*) buf,   size       },
+        { (void*) extra, extra_size }
+    };
+    iovec* cur=size ? iov : iov+1;
+    int count=extra_size ? (int)(iov+2-cur) : (int)(iov+1-cur);
+    while (count) {
+        ssize_t written=writev(file, cur, count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        // Handling partial writes.
+        while (count && (ulen) written >= cur->iov_len) {
+            written -= cur->iov_len;
+            ++cur, --count;
+        }
+        if (count) {
+            cur->iov_base = (char*) cur->iov_base + written;
+            cur->iov_len -= written;
+        }
+    }
+    return true;
+#endif
+}
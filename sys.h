@@ -1,17 +1,33 @@
 #ifndef SSC_SYS_H
 #define SSC_SYS_H
 
+#include "core_types.h"
+
 namespace ssc {
 
 #if NDEBUG
 #define DBG_PANIC(err)
-#define DGB_ASSERT(c, err)
+#define DBG_ASSERT(c, err)
 #else
 #define DBG_PANIC(err) panic(err)
 #define DBG_ASSERT(c, err) if (!(c)) { DBG_PANIC(err); }
 #endif
 
 void panic(const char* err, char exit_code=1);
+
+#ifdef _WIN32
+using FileHandle = void*; // HANDLE
+#else
+using FileHandle = int;   // file descriptor
+#endif
+
+/// Writes `buf` followed by `extra` to the file using as few
+/// system calls as possible. Partial writes are continued.
+///
+/// \return false if the operating system reports an error.
+///
+bool write_all(FileHandle file, const char* buf, ulen size,
+               const char* extra=nullptr, ulen extra_size=0);
 }
 
 #endif
@@ -0,0 +1,66 @@
+#include "test.h"
+#include "diag.h"
+
+#include <string>
+#include <thread>
+
+using namespace ssc;
+
+// Streams committing under the same key come out one stream after
+// the other, whichever order the threads ran in.
+static void equal_keys() {
+    constexpr ulen STREAMS=4;
+    constexpr ulen MESSAGES=200;
+
+    DiagQueue queue;
+    std::thread threads[STREAMS];
+    for (ulen i=0; i < STREAMS; ++i) {
+        // Created in reverse so the ids, not the creation order,
+        // decide.
+        ulen id=STREAMS-1 - i;
+        threads[i] = std::thread([&queue, id] {
+            DiagStream stream { queue, id };
+            for (ulen j=0; j < MESSAGES; ++j) {
+                stream.set_order_key(j % 2);
+                stream.write("%s.%s ", id, j);
+                stream.commit();
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    StringOutStream out;
+    queue.drain(out);
+
+    std::string expected;
+    for (ulen key=0; key < 2; ++key) {
+        for (ulen id=0; id < STREAMS; ++id) {
+            for (ulen j=key; j < MESSAGES; j += 2)
+                expected += std::to_string(id) + "." + std::to_string(j) + " ";
+        }
+    }
+    CHECK(out.to_string() == expected);
+}
+
+static void default_ids() {
+    DiagQueue queue;
+    DiagStream first { queue };
+    DiagStream second { queue };
+    CHECK(first.get_stream_id() < second.get_stream_id());
+
+    second.write("b");
+    second.commit();
+    first.write("a");
+    first.commit();
+
+    StringOutStream out;
+    queue.drain(out);
+    CHECK(out.to_string() == "ab");
+}
+
+int main() {
+    equal_keys();
+    default_ids();
+    return test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "test.h"
+#include "util/HashMap.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace ssc;
+
+template<typename M>
+static bool same_entries(M& map, const std::unordered_map<u64, u64>& expected) {
+    if (map.size() != expected.size())
+        return false;
+    for (auto [key, value] : expected) {
+        u64* v=map.get(key);
+        if (!v || *v != value)
+            return false;
+    }
+    ulen seen=0;
+    for (auto& entry : map) {
+        auto it=expected.find(entry.key);
+        if (it == expected.end() || it->second != entry.value)
+            return false;
+        ++seen;
+    }
+    return seen == expected.size();
+}
+
+// Keys are drawn from a small range so inserts, erases and
+// lookups keep hitting the same keys and slots get reused.
+static void random_operations() {
+    std::mt19937_64 rng(19);
+    HashMap<u64, u64> map;
+    std::unordered_map<u64, u64> expected;
+    for (ulen i=0; i < 200000; ++i) {
+        u64 key=rng() % 2048;
+        switch (rng() % 4) {
+            case 0:
+            case 1: {
+                u64 value=rng();
+                map.set(key, value);
+                expected[key] = value;
+                break;
+            }
+            case 2:
+                CHECK(map.erase(key) == (expected.erase(key) == 1));
+                break;
+            case 3: {
+                u64* value=map.get(key);
+                auto it=expected.find(key);
+                CHECK((value != nullptr) == (it != expected.end()));
+                if (value && it != expected.end())
+                    CHECK(*value == it->second);
+                break;
+            }
+        }
+    }
+    CHECK(same_entries(map, expected));
+}
+
+// All the keys hash to the first group so once it is full,
+// erasing leaves a deleted slot rather than an empty one. The
+// next insert reuses that slot instead of growing the table.
+struct FirstGroupHash {
+    u64 operator()(u64 key) const { return key & 0x7f; }
+};
+
+static void tombstones() {
+    HashMap<u64, u64, FirstGroupHash> map;
+    map.reserve(20);
+    for (u64 i=0; i < 20; ++i)
+        map.set(i, i);
+    const u64* last=map.get(19);
+
+    for (ulen round=0; round < 1000; ++round) {
+        u64 key=round % 16;
+        const u64* slot=map.get(key);
+        CHECK(map.erase(key));
+        CHECK(!map.contains(key));
+        CHECK(map.get(key) == nullptr);
+        map.set(key, round);
+        CHECK(map.get(key) == slot);
+        CHECK(*map.get(key) == round);
+        CHECK(map.size() == 20);
+    }
+    // Nothing was rehashed.
+    CHECK(map.get(19) == last);
+    for (u64 i=0; i < 20; ++i)
+        CHECK(map.contains(i));
+}
+
+// Growing past one group of 16 slots puts keys in several
+// groups which probing has to walk across.
+static void growth() {
+    HashMap<std::string, u64> map;
+    for (u64 i=0; i < 1000; ++i) {
+        map.set(std::to_string(i) + " is a string which needs the heap", i);
+        if (i == 13 || i == 14 || i == 15 || i == 16 || i == 27 || i == 28) {
+            for (u64 j=0; j <= i; ++j)
+                CHECK(*map.get(std::to_string(j) + " is a string which needs the heap") == j);
+        }
+    }
+    CHECK(map.size() == 1000);
+    for (u64 i=0; i < 1000; ++i)
+        CHECK(*map.get(std::to_string(i) + " is a string which needs the heap") == i);
+    CHECK(!map.get(std::string("1000 is a string which needs the heap")));
+}
+
+static void arena_copy_and_move() {
+    ArenaAllocator first(4096), second(4096);
+    HashMap<u64, u64, Hash<u64>, std::equal_to<>, ArenaAllocator> a(first);
+    std::unordered_map<u64, u64> expected;
+    for (u64 i=0; i < 300; ++i) {
+        a.set(i * 7, i);
+        expected[i * 7] = i;
+    }
+
+    HashMap<u64, u64, Hash<u64>, std::equal_to<>, ArenaAllocator> copy=a;
+    CHECK(&copy.get_allocator() == &first);
+    CHECK(same_entries(copy, expected));
+
+    // Another arena cannot take over the memory so the entries
+    // are moved into its own.
+    HashMap<u64, u64, Hash<u64>, std::equal_to<>, ArenaAllocator> b(second);
+    b.set(1, 1);
+    b = std::move(a);
+    CHECK(&b.get_allocator() == &second);
+    CHECK(same_entries(b, expected));
+    CHECK(a.empty());
+
+    // The same arena can.
+    HashMap<u64, u64, Hash<u64>, std::equal_to<>, ArenaAllocator> c(first);
+    c = std::move(copy);
+    CHECK(same_entries(c, expected));
+    CHECK(copy.empty());
+
+    HashMap<u64, u64, Hash<u64>, std::equal_to<>, ArenaAllocator> d=std::move(c);
+    CHECK(same_entries(d, expected));
+    CHECK(c.empty());
+    d.set(5000, 1);
+    CHECK(d.size() == 301);
+
+    copy = d;
+    CHECK(copy.size() == 301 && *copy.get(5000) == 1);
+}
+
+int main() {
+    random_operations();
+    tombstones();
+    growth();
+    arena_copy_and_move();
+    return test::failures == 0 ? 0 : 1;
+}
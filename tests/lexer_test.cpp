@@ -0,0 +1,135 @@
+#include "test.h"
+#include "lexer.h"
+
+#include <initializer_list>
+
+using namespace ssc;
+
+struct Lexed {
+    SourceManager  sources;
+    StringInterner interner;
+    Tokens         tokens;
+    ulen           errors=0;
+    SourceOffset   start=0;
+
+    explicit Lexed(StrSlice contents) {
+        const SourceFile* file=sources.add_buffer("test", contents);
+        start=file->start;
+        errors=Lexer(*file, interner).lex(tokens);
+    }
+
+    bool kinds_are(std::initializer_list<TokenKind> kinds) const {
+        if (tokens.size() != kinds.size())
+            return false;
+        ulen idx=0;
+        for (TokenKind kind : kinds) {
+            if (tokens.kind(idx++) != kind)
+                return false;
+        }
+        return true;
+    }
+
+    SourceOffset offset(ulen idx) const { return tokens.loc(idx) - start; }
+};
+
+static void operators() {
+    using enum TokenKind;
+    Lexed lexed("<=> <<= <= << < >>= >> >= > :: : .. . -> -= - => == = != ! && &= & || |= |");
+    CHECK(lexed.errors == 0);
+    CHECK(lexed.kinds_are({
+        Spaceship, ShlEq, LtEq, Shl, Lt, ShrEq, Shr, GtEq, Gt, ColonColon, Colon,
+        DotDot, Dot, Arrow, MinusEq, Minus, FatArrow, EqEq, Eq, BangEq, Bang,
+        AmpAmp, AmpEq, Amp, PipePipe, PipeEq, Pipe, Eof,
+    }));
+    CHECK(lexed.tokens.length(0) == 3);
+    CHECK(lexed.tokens.length(2) == 2);
+}
+
+static void numbers() {
+    using enum TokenKind;
+    Lexed lexed("1..2 3e+5 0x1F 1.5 7");
+    CHECK(lexed.errors == 0);
+    CHECK(lexed.kinds_are({ Int, DotDot, Int, Float, Int, Float, Int, Eof }));
+    CHECK(lexed.tokens.length(0) == 1);
+    CHECK(lexed.tokens.length(3) == 4);
+    CHECK(lexed.tokens.length(4) == 4);
+    CHECK(lexed.offset(4) == 10);
+}
+
+static void keywords() {
+    using enum TokenKind;
+    Lexed lexed("fn fnx while whil _ let");
+    CHECK(lexed.kinds_are({ KwFn, Ident, KwWhile, Ident, Ident, KwLet, Eof }));
+    CHECK(lexed.interner.str(lexed.tokens.symbol(1)) == "fnx");
+}
+
+static void unterminated() {
+    using enum TokenKind;
+    {
+        Lexed lexed("\"abc\nx");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Error, Ident, Eof }));
+    }
+    {
+        Lexed lexed("x \"abc");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Ident, Error, Eof }));
+        CHECK(lexed.offset(1) == 2);
+    }
+    {
+        Lexed lexed("x /* abc");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Ident, Error, Eof }));
+        CHECK(lexed.offset(1) == 2);
+    }
+    {
+        Lexed lexed("x /* a */ // b\ny");
+        CHECK(lexed.errors == 0);
+        CHECK(lexed.kinds_are({ Ident, Ident, Eof }));
+    }
+}
+
+static void bom() {
+    using enum TokenKind;
+    Lexed lexed("\xef\xbb\xbfx = 1");
+    CHECK(lexed.errors == 0);
+    CHECK(lexed.kinds_are({ Ident, Eq, Int, Eof }));
+    CHECK(lexed.offset(0) == 3);
+}
+
+static void invalid_utf8() {
+    using enum TokenKind;
+    {
+        Lexed lexed("a b\xff" "c d");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Ident, Error, Ident, Eof }));
+        CHECK(lexed.offset(1) == 2);
+        CHECK(lexed.tokens.length(1) == 3);
+    }
+    {
+        Lexed lexed("a // \xc3\n b");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Ident, Error, Ident, Eof }));
+        CHECK(lexed.offset(1) == 5);
+    }
+    {
+        Lexed lexed("\"\xed\xa0\x80\" x");
+        CHECK(lexed.errors == 1);
+        CHECK(lexed.kinds_are({ Error, Ident, Eof }));
+    }
+    {
+        Lexed lexed("a \xe2\x82\xac b");
+        CHECK(lexed.errors == 0);
+        CHECK(lexed.kinds_are({ Ident, Ident, Ident, Eof }));
+    }
+}
+
+int main() {
+    operators();
+    numbers();
+    keywords();
+    unterminated();
+    bom();
+    invalid_utf8();
+    return test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+#include "test.h"
+#include "util/BucketList.h"
+#include "util/SmallList.h"
+#include "util/SoAList.h"
+
+#include <random>
+#include <string>
+
+using namespace ssc;
+
+// Long enough that std::string keeps it on the heap rather than
+// in its small string buffer.
+static std::string str(ulen i) {
+    return "a string which does not fit inline #" + std::to_string(i);
+}
+
+template<typename L>
+static bool holds_strings(const L& list, ulen from, ulen count) {
+    if (list.size() != count)
+        return false;
+    for (ulen i=0; i < count; ++i) {
+        if (list[i] != str(from + i))
+            return false;
+    }
+    return true;
+}
+
+static void small_spill() {
+    SmallList<std::string, 4> list;
+    for (ulen i=0; i < 4; ++i)
+        list.add(str(i));
+    CHECK(!list.spilled());
+    list.add(str(4));
+    CHECK(list.spilled());
+    CHECK(holds_strings(list, 0, 5));
+
+    for (ulen i=5; i < 40; ++i)
+        list.add(str(i));
+    CHECK(holds_strings(list, 0, 40));
+
+    // Trimming only moves the elements back inline once they fit.
+    list.pop_back_n(30);
+    list.trim();
+    CHECK(list.spilled());
+    CHECK(holds_strings(list, 0, 10));
+    list.pop_back_n(7);
+    list.trim();
+    CHECK(!list.spilled());
+    CHECK(holds_strings(list, 0, 3));
+
+    list.clear();
+    list.trim();
+    CHECK(!list.spilled());
+    CHECK(list.empty());
+}
+
+static void small_move() {
+    {
+        SmallList<std::string, 4> inline_list { str(0), str(1) };
+        SmallList<std::string, 4> moved=std::move(inline_list);
+        CHECK(!moved.spilled());
+        CHECK(holds_strings(moved, 0, 2));
+        CHECK(inline_list.empty());
+    }
+    {
+        SmallList<std::string, 2> spilled { str(0), str(1), str(2) };
+        const std::string* elms=spilled.begin();
+        SmallList<std::string, 2> moved=std::move(spilled);
+        // Spilled elements are taken over without moving them.
+        CHECK(moved.begin() == elms);
+        CHECK(holds_strings(moved, 0, 3));
+        CHECK(spilled.empty() && !spilled.spilled());
+
+        SmallList<std::string, 2> assigned { str(7) };
+        assigned = std::move(moved);
+        CHECK(assigned.begin() == elms);
+        CHECK(holds_strings(assigned, 0, 3));
+        CHECK(moved.empty());
+
+        SmallList<std::string, 2> copy=assigned;
+        CHECK(copy == assigned);
+        CHECK(copy.begin() != assigned.begin());
+        copy.add(str(3));
+        CHECK(copy != assigned);
+    }
+    {
+        // Lists in different arenas cannot share memory so the
+        // elements are moved into the arena of the target.
+        ArenaAllocator first(1024), second(1024);
+        SmallList<std::string, 2, ArenaAllocator> from(first);
+        for (ulen i=0; i < 9; ++i)
+            from.add(str(i));
+        SmallList<std::string, 2, ArenaAllocator> to(second);
+        to.add(str(100));
+        to = std::move(from);
+        CHECK(&to.get_allocator() == &second);
+        CHECK(holds_strings(to, 0, 9));
+        CHECK(from.empty());
+    }
+}
+
+static void bulk_operations() {
+    List<std::string> list;
+    std::string more[] { str(100), str(101), str(102) };
+    for (ulen i=0; i < 10; ++i)
+        list.add(str(i));
+
+    // Inserting in the middle shifts the elements after it
+    // towards the end, which overlaps for short moves.
+    std::string* at=list.insert_range(list.begin() + 3, more);
+    CHECK(at == list.begin() + 3);
+    CHECK(list.size() == 13);
+    CHECK(list[2] == str(2) && list[3] == str(100) && list[5] == str(102));
+    CHECK(list[6] == str(3) && list[12] == str(9));
+    list.append_range(List<std::string> {});
+    list.append_range(more);
+    CHECK(list.size() == 16 && list.back() == str(102));
+
+    ulen removed=list.erase_if([](const std::string& s) {
+        return s == str(100) || s == str(4);
+    });
+    CHECK(removed == 3);
+    CHECK(list.size() == 13);
+    CHECK(list[3] == str(101) && list[5] == str(3) && list[6] == str(5));
+
+    list.swap_remove(list.begin());
+    CHECK(list.size() == 12 && list.front() == str(102));
+    list.swap_remove(list.end() - 1);
+    CHECK(list.size() == 11 && list.back() == str(9));
+
+    list.pop_front_n(5);
+    CHECK(list.size() == 6);
+    CHECK(list.front() == str(3));
+    CHECK(list[1] == str(5));
+    CHECK(list.back() == str(9));
+    list.pop_front_n(6);
+    CHECK(list.empty());
+}
+
+// Checks the vectorized searches of one element width against a
+// plain loop, at every offset from an aligned address and with
+// values which only differ in their upper half.
+template<typename U>
+static void searches(std::mt19937_64& rng) {
+    List<U> elms;
+    for (ulen i=0; i < 300; ++i) {
+        U v=(U) (rng() % 4);
+        if (sizeof(U) == 8 && rng() % 3 == 0)
+            v |= (U) ((u64) 1 << 40);
+        elms.add(v);
+    }
+
+    for (ulen trial=0; trial < 400; ++trial) {
+        ulen from=rng() % 33;
+        ulen count=rng() % (elms.size() - from);
+        const U* p=elms.begin() + from;
+        U v=(U) (rng() % 5);
+
+        ulen expected_idx=count, expected_count=0;
+        for (ulen i=0; i < count; ++i) {
+            if (p[i] == v) {
+                if (expected_idx == count)
+                    expected_idx = i;
+                ++expected_count;
+            }
+        }
+        CHECK(simd_find(p, count, v) == expected_idx);
+        CHECK(simd_find_baseline(p, count, v) == expected_idx);
+        CHECK(simd_count(p, count, v) == expected_count);
+        CHECK(simd_count_baseline(p, count, v) == expected_count);
+        CHECK(find_elm(p, count, v) == p + expected_idx);
+        CHECK(count_elms(p, count, v) == expected_count);
+    }
+
+    CHECK(elms.contains((U) 3));
+    CHECK(!elms.contains((U) 4));
+    CHECK(elms.find((U) 4) == elms.end());
+}
+
+static void searches() {
+    std::mt19937_64 rng(16);
+    searches<u8>(rng);
+    searches<u16>(rng);
+    searches<u32>(rng);
+    searches<u64>(rng);
+
+    // Enums and pointers are searched as integers.
+    enum class Kind : u16 { A, B, C };
+    List<Kind> kinds;
+    for (ulen i=0; i < 40; ++i)
+        kinds.add(i == 33 ? Kind::C : Kind::A);
+    CHECK(kinds.find(Kind::C) == kinds.begin() + 33);
+    CHECK(kinds.count(Kind::A) == 39);
+    CHECK(!kinds.contains(Kind::B));
+
+    List<std::string> strs { str(0), str(1), str(0) };
+    CHECK(strs.find(str(1)) == strs.begin() + 1);
+    CHECK(strs.count(str(0)) == 2);
+}
+
+static void bucket_stability() {
+    BucketList<std::string> list;
+    List<const std::string*> addresses;
+    for (ulen i=0; i < 1000; ++i)
+        addresses.add(&list.add(str(i)));
+
+    // Growing never moves an element.
+    for (ulen i=0; i < 1000; ++i) {
+        CHECK(&list[i] == addresses[i]);
+        CHECK(list[i] == str(i));
+    }
+    CHECK(&list.front() == addresses[0] && &list.back() == addresses[999]);
+
+    list.pop_back();
+    CHECK(list.size() == 999);
+    list.clear();
+    CHECK(list.empty());
+    // The segments are kept so the same slots are used again.
+    CHECK(&list.add(str(0)) == addresses[0]);
+
+    BucketList<std::string> moved=std::move(list);
+    CHECK(&moved[0] == addresses[0]);
+    CHECK(list.empty());
+}
+
+// Segments hold 4, 8, 16 and so on elements. Iterating has to
+// cross from one segment into the next at the right index, and
+// stop when the last segment is only partly used.
+static void bucket_iteration() {
+    for (ulen size : { 0, 1, 3, 4, 5, 11, 12, 13, 28, 29, 60 }) {
+        BucketList<u32, DynAllocator, 4> list;
+        for (u32 i=0; i < size; ++i)
+            list.add(i);
+
+        u32 next=0;
+        for (u32 v : list)
+            CHECK(v == next++);
+        CHECK(next == size);
+
+        const auto& clist=list;
+        ulen n=0;
+        for (auto it=clist.begin(); it != clist.end(); it++)
+            CHECK(*it == clist[n++]);
+        CHECK(n == size);
+    }
+}
+
+static void soa_rows() {
+    SoAList<u32, std::string, u8> rows;
+    for (u32 i=0; i < 100; ++i)
+        rows.add(i, std::string(i % 40, 'a' + i % 26), (u8) (i * 3));
+
+    u32 idx=0;
+    for (auto [num, str, byte] : rows) {
+        CHECK(num == idx);
+        CHECK(str == std::string(idx % 40, 'a' + idx % 26));
+        CHECK(byte == (u8) (idx * 3));
+        ++idx;
+    }
+    CHECK(idx == 100);
+
+    // Rows refer to the elements of the columns.
+    for (auto [num, str, byte] : rows)
+        num *= 2;
+    const auto& crows=rows;
+    u32 sum=0;
+    for (auto [num, str, byte] : crows)
+        sum += num;
+    CHECK(sum == 99*100);
+    CHECK(rows.column<0>()[7] == 14);
+}
+
+int main() {
+    small_spill();
+    small_move();
+    bulk_operations();
+    searches();
+    bucket_stability();
+    bucket_iteration();
+    soa_rows();
+    return test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "test.h"
+#include "mem.h"
+
+#include <cstring>
+#include <thread>
+
+using namespace ssc;
+
+// More arenas than slots in the per-thread cache, so some of them
+// share a slot and evict each other when used in turn.
+static void alternating_arenas() {
+    constexpr ulen ARENA_COUNT=9;
+    constexpr ulen ROUNDS=20000;
+    constexpr ulen SIZE=16;
+
+    ConcurrentArenaAllocator arenas[ARENA_COUNT];
+    char* last[ARENA_COUNT]={};
+    ulen jumps[ARENA_COUNT]={};
+    for (ulen round=0; round < ROUNDS; ++round) {
+        for (ulen i=0; i < ARENA_COUNT; ++i) {
+            char* p=(char*) arenas[i].alloc(SIZE);
+            if (last[i] && p != last[i] + SIZE)
+                ++jumps[i];
+            last[i]=p;
+        }
+    }
+
+    // Allocations stay in the thread's chunk until it is full.
+    ulen chunks=ROUNDS*SIZE / ConcurrentArenaAllocator::DEFAULT_THREAD_CHUNK_SIZE + 1;
+    for (ulen i=0; i < ARENA_COUNT; ++i)
+        CHECK(jumps[i] <= chunks);
+}
+
+// Small objects and large blocks mixed together, with large
+// blocks resized the way a growing list resizes them.
+static void slab_sizes() {
+    SlabAllocator slabs;
+    for (ulen size : { 1, 16, 100, 4096, 4097, 1 << 16, 1 << 20 }) {
+        void* ptrs[64];
+        for (void*& p : ptrs) {
+            p=slabs.alloc(size);
+            CHECK(((uintptr_t) p & 15) == 0);
+            memset(p, 0xab, size);
+        }
+        for (void* p : ptrs)
+            slabs.free(p);
+    }
+    void* p=nullptr;
+    for (ulen size=8192; size <= (1 << 22); size *= 2) {
+        void* bigger=slabs.alloc(size);
+        if (p) {
+            memcpy(bigger, p, size/2);
+            slabs.free(p);
+        }
+        p=bigger;
+    }
+    slabs.free(p);
+}
+
+// Destroyed after the thread's cache of the slab allocator because
+// it is created before the cache.
+struct FreesAtExit {
+    void* ptr=nullptr;
+    ~FreesAtExit() {
+        SlabAllocator slabs;
+        slabs.free(ptr);
+        slabs.free(slabs.alloc(48));
+    }
+};
+
+static void slab_thread_teardown() {
+    std::thread thread([] {
+        thread_local FreesAtExit at_exit;
+        SlabAllocator slabs;
+        at_exit.ptr=slabs.alloc(48);
+    });
+    thread.join();
+    SlabAllocator slabs;
+    slabs.free(slabs.alloc(48));
+}
+
+int main() {
+    alternating_arenas();
+    slab_sizes();
+    slab_thread_teardown();
+    return test::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+//===---------------------------------------------------------===
+//
+// The checks shared by the tests under tests/. Each test is an
+// executable which fails if any check does.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_TEST_H
+#define SSC_TEST_H
+
+#include "fmt.h"
+
+namespace ssc::test {
+
+inline int failures=0;
+
+inline void fail(const char* file, int line, const char* expr) {
+    ssc::println("%s:%s: check failed: %s", file, line, expr);
+    ++failures;
+}
+}
+
+#define CHECK(c) do { if (!(c)) ssc::test::fail(__FILE__, __LINE__, #c); } while (0)
+
+#endif
@@ -0,0 +1,69 @@
+#include "test.h"
+#include "utf8.h"
+
+#include <random>
+#include <string>
+
+using namespace ssc;
+
+// Builds inputs out of long runs of ASCII, so the block checks are
+// taken, mixed with valid sequences of every length, line endings
+// and now and then a random byte which is likely invalid.
+static std::string random_input(std::mt19937_64& rng) {
+    static const char* const PIECES[]={
+        "a", "x = 1;", "\r\n", "\n", "\r", "\xc3\xa9", "\xe2\x82\xac",
+        "\xf0\x9f\x9a\x80", "\xed\x9f\xbf", "\xf4\x8f\xbf\xbf",
+    };
+    std::string s;
+    if (rng() % 8 == 0)
+        s += "\xef\xbb\xbf";
+    ulen pieces=rng() % 64;
+    for (ulen i=0; i < pieces; ++i) {
+        switch (rng() % 8) {
+            case 0:
+                s.append(rng() % 130, 'q');
+                break;
+            case 1:
+                if (rng() % 4 == 0)
+                    s += (char) (rng() % 256);
+                break;
+            default:
+                s += PIECES[rng() % (sizeof(PIECES)/sizeof(PIECES[0]))];
+                break;
+        }
+    }
+    return s;
+}
+
+// What check_utf8 should find, worked out one byte at a time.
+static Utf8Check reference(const std::string& s) {
+    Utf8Check expected;
+    if (s.size() >= 3 && s.compare(0, 3, "\xef\xbb\xbf") == 0)
+        expected.bom_size=3;
+    expected.error_offset=validate_utf8_scalar(s.data(), s.size(), expected.bom_size);
+    expected.is_valid=expected.error_offset == s.size();
+    for (ulen i=expected.bom_size; i+1 < expected.error_offset; ++i)
+        if (s[i] == '\r' && s[i+1] == '\n')
+            expected.has_crlf=true;
+    return expected;
+}
+
+static bool same(const Utf8Check& a, const Utf8Check& b) {
+    return a.bom_size     == b.bom_size     &&
+           a.error_offset == b.error_offset &&
+           a.has_crlf     == b.has_crlf     &&
+           a.is_valid     == b.is_valid;
+}
+
+int main() {
+    std::mt19937_64 rng(22);
+    for (int i=0; i < 100000; ++i) {
+        std::string s=random_input(rng);
+        Utf8Check expected=reference(s);
+        CHECK(same(check_utf8(s.data(), s.size()), expected));
+        CHECK(same(check_utf8_baseline(s.data(), s.size()), expected));
+        if (test::failures)
+            break;
+    }
+    return test::failures == 0 ? 0 : 1;
+}
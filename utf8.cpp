@@ -0,0 +1,350 @@
+#include "utf8.h"
+#include "simd.h"
+
+#include <cstring> // for memcpy
+
+#if SSC_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace ssc {
+
+  // Get the length of the sequence starting at `i`
+  // or 0 if it is invalid.
+static ulen sequence_length(const u8* p, ulen size, ulen i) {
+    u8 c=p[i];
+    if (c < 0x80)
+        return 1;
+    ulen len;
+    u8 lo=0x80, hi=0xbf; // the range of the second byte
+    if (c >= 0xc2 && c <= 0xdf)
+        len=2;
+    else if (c >= 0xe0 && c <= 0xef) {
+        len=3;
+        if (c == 0xe0)      lo=0xa0; // overlong
+        else if (c == 0xed) hi=0x9f; // surrogate
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        len=4;
+        if (c == 0xf0)      lo=0x90; // overlong
+        else if (c == 0xf4) hi=0x8f; // above U+10FFFF
+    } else
+        return 0;
+
+    if (size-i < len || p[i+1] < lo || p[i+1] > hi)
+        return 0;
+    for (ulen k=2; k < len; ++k)
+        if ((p[i+k] & 0xc0) != 0x80)
+            return 0;
+    return len;
+}
+
+ulen validate_utf8_scalar(const char* data, ulen size, ulen start) {
+    const u8* p=(const u8*) data;
+    ulen i=start;
+    while (i < size) {
+        ulen len=sequence_length(p, size, i);
+        if (!len)
+            return i;
+        i += len;
+    }
+    return size;
+}
+
+static bool starts_with_bom(const char* data, ulen size) {
+    return size >= 3 && (u8) data[0] == 0xef &&
+                        (u8) data[1] == 0xbb &&
+                        (u8) data[2] == 0xbf;
+}
+
+  // Finds the exact offset of an error known to be in the block
+  // starting at `block`. The error may be a sequence starting up
+  // to 3 bytes before the block, the continuations there belong
+  // to sequences which were already checked.
+static ulen locate_error(const char* data, ulen size, ulen begin, ulen block) {
+    ulen start=block-begin > 3 ? block-3 : begin;
+    while (start < block && ((u8) data[start] & 0xc0) == 0x80)
+        ++start;
+    return validate_utf8_scalar(data, size, start);
+}
+
+  // Finds "\r\n" within the bytes which are scanned by bits,
+  // `prev_cr` carries a '\r' at the end of the previous block.
+static bool crlf_in_block(u64 cr, u64 lf, bool prev_cr) {
+    return (cr & (lf >> 1)) || (prev_cr && (lf & 1));
+}
+
+#if SSC_SIMD_X86
+
+namespace {
+
+  // The error classes of the lookup tables, a byte is invalid
+  // when the class of its high nibble, the class of the high
+  // nibble of the byte before and the class of the low nibble
+  // of the byte before share a bit.
+constexpr u8 TOO_SHORT     =1 << 0; // a lead not followed by a continuation
+constexpr u8 TOO_LONG      =1 << 1; // a continuation after ASCII
+constexpr u8 OVERLONG_3    =1 << 2;
+constexpr u8 TOO_LARGE     =1 << 3;
+constexpr u8 SURROGATE     =1 << 4;
+constexpr u8 OVERLONG_2    =1 << 5;
+constexpr u8 TOO_LARGE_1000=1 << 6;
+constexpr u8 OVERLONG_4    =1 << 6;
+constexpr u8 TWO_CONTS     =1 << 7; // two continuations, checked by length
+constexpr u8 CARRY         =TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+struct Utf8Avx2 {
+    __m256i error;
+    __m256i prev_input;
+    __m256i prev_incomplete;
+
+    SSC_TARGET_AVX2 Utf8Avx2() :
+        error(_mm256_setzero_si256()),
+        prev_input(_mm256_setzero_si256()),
+        prev_incomplete(_mm256_setzero_si256())
+    {}
+
+    SSC_TARGET_AVX2 static __m256i table(u8 t0, u8 t1, u8 t2,  u8 t3,  u8 t4,  u8 t5,  u8 t6,  u8 t7,
+                                         u8 t8, u8 t9, u8 t10, u8 t11, u8 t12, u8 t13, u8 t14, u8 t15) {
+        return _mm256_setr_epi8(t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+                                t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15);
+    }
+
+    SSC_TARGET_AVX2 static __m256i high_nibbles(__m256i v) {
+        return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+    }
+
+      // The bytes of `input` shifted along by N, bringing in the
+      // last bytes of `prev`.
+    template<int N>
+    SSC_TARGET_AVX2 static __m256i prev(__m256i input, __m256i prev) {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16-N);
+    }
+
+    SSC_TARGET_AVX2 static __m256i special_cases(__m256i input, __m256i prev1) {
+        const __m256i byte_1_high_table=table(
+            // 0___ ASCII
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            // 10__ continuation
+            TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+            // 1100 two byte lead
+            TOO_SHORT | OVERLONG_2,
+            // 1101 two byte lead
+            TOO_SHORT,
+            // 1110 three byte lead
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            // 1111 four byte lead
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+        const __m256i byte_1_low_table=table(
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000);
+        const __m256i byte_2_high_table=table(
+            // 0___ ASCII
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            // 1000
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+            // 1001
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+            // 101_
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+            // 11__ lead
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+        __m256i byte_1_high=_mm256_shuffle_epi8(byte_1_high_table, high_nibbles(prev1));
+        __m256i byte_1_low=_mm256_shuffle_epi8(byte_1_low_table,
+                                               _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)));
+        __m256i byte_2_high=_mm256_shuffle_epi8(byte_2_high_table, high_nibbles(input));
+        return _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    }
+
+      // A byte two after a three or four byte lead, or three after
+      // a four byte lead, must be a continuation. These are the
+      // bytes where TWO_CONTS is expected.
+    SSC_TARGET_AVX2 static __m256i multibyte_lengths(__m256i input, __m256i prev_input, __m256i sc) {
+        __m256i prev2=prev<2>(input, prev_input);
+        __m256i prev3=prev<3>(input, prev_input);
+        __m256i is_third=_mm256_subs_epu8(prev2, _mm256_set1_epi8((char) (0xe0-0x80)));
+        __m256i is_fourth=_mm256_subs_epu8(prev3, _mm256_set1_epi8((char) (0xf0-0x80)));
+        __m256i must23_80=_mm256_and_si256(_mm256_or_si256(is_third, is_fourth),
+                                           _mm256_set1_epi8((char) 0x80));
+        return _mm256_xor_si256(must23_80, sc);
+    }
+
+      // Non-zero where the last bytes start a sequence which
+      // must continue into the next block.
+    SSC_TARGET_AVX2 static __m256i incomplete(__m256i input) {
+        const __m256i max_value=_mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            (char) (0xf0-1), (char) (0xe0-1), (char) (0xc0-1));
+        return _mm256_subs_epu8(input, max_value);
+    }
+
+    SSC_TARGET_AVX2 void check(__m256i input) {
+        __m256i prev1=prev<1>(input, prev_input);
+        __m256i sc=special_cases(input, prev1);
+        error=_mm256_or_si256(error, multibyte_lengths(input, prev_input, sc));
+        prev_incomplete=incomplete(input);
+        prev_input=input;
+    }
+
+      // Checks 64 bytes.
+    SSC_TARGET_AVX2 void check_block(__m256i a, __m256i b) {
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0) {
+            // All ASCII, only a sequence left incomplete by
+            // the previous block can be an error.
+            error=_mm256_or_si256(error, prev_incomplete);
+            prev_incomplete=_mm256_setzero_si256();
+            prev_input=b;
+            return;
+        }
+        check(a);
+        check(b);
+    }
+
+    SSC_TARGET_AVX2 bool has_error() const {
+        return !_mm256_testz_si256(error, error);
+    }
+};
+
+SSC_TARGET_AVX2 u64 match64_avx2(__m256i a, __m256i b, char c) {
+    __m256i needle=_mm256_set1_epi8(c);
+    u64 lo=(u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, needle));
+    u64 hi=(u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle));
+    return lo | (hi << 32);
+}
+
+SSC_TARGET_AVX2 Utf8Check check_utf8_avx2(const char* data, ulen size, ulen begin) {
+    Utf8Check result;
+    result.bom_size=begin;
+    Utf8Avx2 utf8;
+    bool prev_cr=false;
+    ulen i=begin;
+
+    auto check_block=[&](const char* block, ulen offset) SSC_TARGET_AVX2 {
+        __m256i a=_mm256_loadu_si256((const __m256i*) block);
+        __m256i b=_mm256_loadu_si256((const __m256i*) (block+32));
+        utf8.check_block(a, b);
+        if (utf8.has_error()) {
+            result.error_offset=locate_error(data, size, begin, offset);
+            result.is_valid=false;
+            // Line endings are only reported up to the error.
+            for (ulen k=offset; k < result.error_offset && !result.has_crlf; ++k) {
+                result.has_crlf = prev_cr && data[k] == '\n';
+                prev_cr = data[k] == '\r';
+            }
+            return false;
+        }
+        if (!result.has_crlf) {
+            u64 cr=match64_avx2(a, b, '\r');
+            u64 lf=match64_avx2(a, b, '\n');
+            result.has_crlf=crlf_in_block(cr, lf, prev_cr);
+            prev_cr=cr >> 63;
+        }
+        return true;
+    };
+
+    for (; size-i >= 64; i += 64)
+        if (!check_block(data+i, i))
+            return result;
+
+    // The rest is padded with ASCII which also ends any
+    // sequence left incomplete.
+    alignas(32) char tail[64]={};
+    memcpy(tail, data+i, size-i);
+    if (!check_block(tail, i))
+        return result;
+    result.error_offset=size;
+    return result;
+}
+}
+
+#endif
+
+  // Skips runs of ASCII 64 bytes at a time and decodes the rest,
+  // a whole block at a time so text which is mostly not ASCII is
+  // not checked for ASCII after every sequence.
+static Utf8Check check_utf8_ascii(const char* data, ulen size, ulen begin) {
+    Utf8Check result;
+    result.bom_size=begin;
+    const u8* p=(const u8*) data;
+    bool prev_cr=false;
+    ulen i=begin;
+#if SSC_SIMD_X86
+      // Bytes before this are decoded one sequence at a time,
+      // set to the end of a block which is not all ASCII.
+    ulen decode_end=begin;
+#endif
+    while (i < size) {
+#if SSC_SIMD_X86
+        if (i >= decode_end && size-i >= 64) {
+            __m128i v[4];
+            for (int k=0; k < 4; ++k)
+                v[k]=_mm_loadu_si128((const __m128i*) (p+i+16*k));
+            __m128i any=_mm_or_si128(_mm_or_si128(v[0], v[1]), _mm_or_si128(v[2], v[3]));
+            if (_mm_movemask_epi8(any) == 0) {
+                if (!result.has_crlf) {
+                    u64 cr=0, lf=0;
+                    for (int k=0; k < 4; ++k) {
+                        cr |= (u64) (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(v[k], _mm_set1_epi8('\r'))) << (16*k);
+                        lf |= (u64) (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(v[k], _mm_set1_epi8('\n'))) << (16*k);
+                    }
+                    result.has_crlf=crlf_in_block(cr, lf, prev_cr);
+                    prev_cr=cr >> 63;
+                }
+                i += 64;
+                continue;
+            }
+            decode_end=i+64;
+        }
+#endif
+        u8 c=p[i];
+        if (c < 0x80) {
+            if (c == '\n' && prev_cr)
+                result.has_crlf=true;
+            prev_cr = c == '\r';
+            ++i;
+            continue;
+        }
+        ulen len=sequence_length(p, size, i);
+        if (!len) {
+            result.error_offset=i;
+            result.is_valid=false;
+            return result;
+        }
+        i += len;
+        prev_cr=false;
+    }
+    result.error_offset=size;
+    return result;
+}
+
+Utf8Check check_utf8(const char* data, ulen size) {
+    ulen begin=starts_with_bom(data, size) ? 3 : 0;
+#if SSC_SIMD_X86
+    if (cpu_has_avx2())
+        return check_utf8_avx2(data, size, begin);
+#endif
+    return check_utf8_ascii(data, size, begin);
+}
+
+Utf8Check check_utf8_baseline(const char* data, ulen size) {
+    return check_utf8_ascii(data, size, starts_with_bom(data, size) ? 3 : 0);
+}
+}
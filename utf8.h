@@ -0,0 +1,56 @@
+//===---------------------------------------------------------===
+//
+// Checks that source input is valid UTF-8 before it is lexed.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_UTF8_H
+#define SSC_UTF8_H
+
+#include "core_types.h"
+
+namespace ssc {
+
+/// What checking a source buffer found.
+///
+struct Utf8Check {
+      // 3 if the input starts with a byte order mark which
+      // should be skipped, otherwise 0.
+    ulen bom_size=0;
+      // The offset of the first byte of the first invalid
+      // sequence, or the size of the input if it is valid.
+    ulen error_offset=0;
+      // Whether a "\r\n" line ending was seen before the
+      // first error.
+    bool has_crlf=false;
+    bool is_valid=true;
+
+    bool valid() const { return is_valid; }
+};
+
+/// Validates the input as UTF-8 while looking for a byte order
+/// mark and "\r\n" line endings in the same pass.
+///
+/// With AVX2, 64 bytes are checked per step by classifying each
+/// byte along with the bytes before it using table lookups, so
+/// no byte is decoded. Without AVX2, runs of ASCII are skipped
+/// 64 bytes at a time and the rest is decoded.
+///
+Utf8Check check_utf8(const char* data, ulen size);
+
+/// check_utf8 without AVX2, which is what check_utf8 does on
+/// processors without it. Lets the two be checked against
+/// each other on any processor.
+///
+Utf8Check check_utf8_baseline(const char* data, ulen size);
+
+/// Decodes the input one sequence at a time, used as the
+/// reference for check_utf8 and for finding the exact offset
+/// of an error.
+///
+/// \return the offset of the first invalid sequence starting
+/// at or after `start`, or `size` if there is none.
+///
+ulen validate_utf8_scalar(const char* data, ulen size, ulen start=0);
+}
+
+#endif
@@ -0,0 +1,262 @@
+//===---------------------------------------------------------===
+//
+// A list which never moves its elements, allowing pointers to
+// the elements to be held for as long as the list lives.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_BUCKET_LIST_H
+#define SSC_BUCKET_LIST_H
+
+#include "List.h"
+
+#include <bit> // for std::bit_width
+
+namespace ssc {
+
+/// A list which stores its elements in segments instead of
+/// one array. Segment `k` holds `FIRST_SEGMENT_SIZE << k`
+/// elements so the segment and offset of an index are found
+/// with a count of leading zeros. Growing adds a segment
+/// and never moves the existing elements so pointers to the
+/// elements stay valid until they are removed.
+///
+/// Since the segments double in size, nearly all elements
+/// are in a few large segments which keeps iteration close
+/// to the speed of iterating a List.
+///
+template<typename T, typename Allocator = DynAllocator,
+         ulen FIRST_SEGMENT_SIZE = 16>
+class BucketList {
+private:
+    static_assert(is_power_of2(FIRST_SEGMENT_SIZE),
+                  "the first segment size must be a power of 2");
+
+    static constexpr bool ALLOC_BY_REF=HOLD_ALLOCATOR_BY_REF<Allocator>;
+    static constexpr ulen FIRST_SEGMENT_BITS=std::bit_width(FIRST_SEGMENT_SIZE)-1;
+    static constexpr ulen MAX_SEGMENTS=sizeof(ulen)*8 - FIRST_SEGMENT_BITS;
+
+    ulen csize=0;
+    ulen segment_count=0;
+    T*   segments[MAX_SEGMENTS];
+
+    [[no_unique_address]]
+    std::conditional_t<ALLOC_BY_REF, Allocator*, Allocator> allocator;
+
+    static ulen segment_size(ulen segment) {
+        return FIRST_SEGMENT_SIZE << segment;
+    }
+
+      // Get the segment of an index, the index of the first
+      // element in segment k is FIRST_SEGMENT_SIZE*(2^k - 1).
+    static ulen segment_of(ulen idx) {
+        return std::bit_width(idx + FIRST_SEGMENT_SIZE) - 1 - FIRST_SEGMENT_BITS;
+    }
+
+    static ulen segment_start(ulen segment) {
+        return segment_size(segment) - FIRST_SEGMENT_SIZE;
+    }
+
+    T* at(ulen idx) const {
+        ulen segment = segment_of(idx);
+        return segments[segment] + (idx - segment_start(segment));
+    }
+
+    void grow() {
+        segments[segment_count] =
+            (T*) get_allocator().alloc(segment_size(segment_count) * sizeof(T));
+        ++segment_count;
+    }
+
+    static auto get_allocator_storage(Allocator& allocator) {
+        if constexpr (ALLOC_BY_REF)
+            return &allocator;
+        else
+            return allocator;
+    }
+
+    void destroy_all() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (ulen s=0, left=csize; left; ++s) {
+                ulen n = std::min(left, segment_size(s));
+                for (T* p=segments[s], *e=p+n; p != e; ++p)
+                    p->~T();
+                left -= n;
+            }
+        }
+    }
+
+public:
+
+    /// Iterates the elements in order, moving from segment
+    /// to segment at the end of each one.
+    ///
+    template<typename E>
+    class Iterator {
+    private:
+        friend class BucketList;
+
+        const BucketList* list;
+        ulen segment;
+        E*   ptr;
+        E*   segment_end;
+
+        Iterator(const BucketList* list, ulen idx) :
+            list(list), segment(0), ptr(nullptr), segment_end(nullptr)
+        {
+            if (idx >= list->csize)
+                return;
+            segment     = segment_of(idx);
+            ptr         = list->segments[segment] + (idx - segment_start(segment));
+            segment_end = list->segments[segment] +
+                          std::min(segment_size(segment),
+                                   list->csize - segment_start(segment));
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::remove_const_t<E>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = E*;
+        using reference         = E&;
+
+        Iterator() : list(nullptr), segment(0), ptr(nullptr), segment_end(nullptr) {}
+
+        E& operator*() const { return *ptr; }
+        E* operator->() const { return ptr; }
+
+        Iterator& operator++() {
+            if (++ptr == segment_end) {
+                ulen next = segment_start(segment+1);
+                if (next >= list->csize) {
+                    ptr = segment_end = nullptr;
+                    return *this;
+                }
+                ++segment;
+                ptr         = list->segments[segment];
+                segment_end = ptr + std::min(segment_size(segment),
+                                             list->csize - next);
+            }
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const Iterator& rhs) const { return ptr == rhs.ptr; }
+        bool operator!=(const Iterator& rhs) const { return ptr != rhs.ptr; }
+    };
+
+    ~BucketList() {
+        destroy_all();
+        for (ulen s=0; s < segment_count; ++s)
+            get_allocator().free(segments[s]);
+    }
+    BucketList() requires (!ALLOC_BY_REF) = default;
+    explicit BucketList(Allocator& allocator) :
+        allocator(get_allocator_storage(allocator))
+    {}
+      // Elements are referred to by address, copying them
+      // would be a mistake.
+    BucketList(const BucketList&) = delete;
+    BucketList& operator=(const BucketList&) = delete;
+      // move constructor, the elements stay where they are.
+    BucketList(BucketList&& rhs) noexcept :
+        csize(std::exchange(rhs.csize, 0)),
+        segment_count(std::exchange(rhs.segment_count, 0)),
+        allocator(rhs.allocator)
+    {
+        std::copy(rhs.segments, rhs.segments+segment_count, segments);
+    }
+
+    /// Get the allocator the list allocates its memory with.
+    ///
+    Allocator& get_allocator() {
+        if constexpr (ALLOC_BY_REF)
+            return *allocator;
+        else
+            return allocator;
+    }
+
+    /// Get the number of elements in this list.
+    ///
+    ulen size() const { return csize; }
+
+    /// Whether the list has no elements.
+    ///
+    bool empty() const { return csize == 0; }
+
+    Iterator<T> begin() { return Iterator<T>(this, 0); }
+    Iterator<T> end() { return Iterator<T>(); }
+    Iterator<const T> begin() const { return Iterator<const T>(this, 0); }
+    Iterator<const T> end() const { return Iterator<const T>(); }
+
+    /// Constructs an element in place at the end of the list.
+    ///
+    /// \return the element which stays at the same address
+    /// until it is removed.
+    ///
+    template<typename... Args>
+    T& emplace(Args&&... args) {
+        if (csize == segment_start(segment_count)) grow();
+        T* elm = ::new (at(csize)) T(std::forward<Args>(args)...);
+        ++csize;
+        return *elm;
+    }
+
+    /// Append the element to the end of the list.
+    ///
+    T& add(T&& elm) {
+        return emplace(std::move(elm));
+    }
+
+    /// Append the element to the end of the list.
+    ///
+    T& add(const T& elm) {
+        return emplace(elm);
+    }
+
+    T& operator[](ulen idx) {
+        DBG_ASSERT(idx < csize, "bucket list out of bounds");
+        return *at(idx);
+    }
+    const T& operator[](ulen idx) const {
+        DBG_ASSERT(idx < csize, "bucket list out of bounds");
+        return *at(idx);
+    }
+
+    /// Get the first element.
+    ///
+    T& front() {
+        DBG_ASSERT(!empty(), "cannot call front() on empty list");
+        return *at(0);
+    }
+
+    /// Get the last element.
+    ///
+    T& back() {
+        DBG_ASSERT(!empty(), "cannot call back() on empty list");
+        return *at(csize-1);
+    }
+
+    /// Removes the last element of the list.
+    ///
+    void pop_back() {
+        DBG_ASSERT(!empty(), "cannot pop an empty list");
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            at(csize-1)->~T();
+        --csize;
+    }
+
+    /// Empties the list of all the elements but keeps
+    /// the segments for reuse.
+    ///
+    void clear() {
+        destroy_all();
+        csize = 0;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,129 @@
+//===---------------------------------------------------------===
+//
+// Fast hash functions for integers and byte strings used by
+// the hash tables.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_HASH_H
+#define SSC_HASH_H
+
+#include <cstring>     // for memcpy
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "core_types.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>    // for _umul128
+#endif
+
+namespace ssc {
+
+constexpr u64 HASH_K0=0xa0761d6478bd642full;
+constexpr u64 HASH_K1=0xe7037ed1a0b428dbull;
+constexpr u64 HASH_K2=0x8ebc6af09c88c6e3ull;
+
+/// Multiplies the values into 128 bits and folds the halves
+/// together, which mixes every input bit into every output bit.
+///
+inline u64 hash_mix(u64 a, u64 b) {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    u64 hi;
+    u64 lo=_umul128(a, b, &hi);
+    return lo ^ hi;
+#elif defined(__SIZEOF_INT128__)
+    __uint128_t r=(__uint128_t) a * b;
+    return (u64) r ^ (u64) (r >> 64);
+#else
+    // 32-bit targets have no 128-bit product so it is put
+    // together from the products of the 32-bit halves.
+    u64 a_lo=(u32) a, a_hi=a >> 32;
+    u64 b_lo=(u32) b, b_hi=b >> 32;
+    u64 lo_lo=a_lo * b_lo;
+    u64 hi_lo=a_hi * b_lo;
+    u64 lo_hi=a_lo * b_hi;
+    u64 hi_hi=a_hi * b_hi;
+    u64 cross=(lo_lo >> 32) + (u32) hi_lo + lo_hi;
+    u64 hi=hi_hi + (hi_lo >> 32) + (cross >> 32);
+    u64 lo=(cross << 32) | (u32) lo_lo;
+    return lo ^ hi;
+#endif
+}
+
+inline u64 hash_read64(const u8* p) {
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline u64 hash_read32(const u8* p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/// Hashes the bytes 16 at a time. Short strings, such as most
+/// identifiers, are read with two overlapping loads and
+/// no loop.
+///
+inline u64 hash_bytes(const void* data, ulen size, u64 seed=0) {
+    const u8* p=(const u8*) data;
+    u64 h=seed ^ HASH_K0;
+    ulen left=size;
+    for (; left > 16; left -= 16, p += 16)
+        h=hash_mix(hash_read64(p) ^ HASH_K1, hash_read64(p+8) ^ h);
+
+    u64 a=0, b=0;
+    if (left >= 8) {
+        a=hash_read64(p);
+        b=hash_read64(p+left-8);
+    } else if (left >= 4) {
+        a=hash_read32(p);
+        b=hash_read32(p+left-4);
+    } else if (left > 0) {
+        a=((u64) p[0] << 16) | ((u64) p[left >> 1] << 8) | p[left-1];
+    }
+    h=hash_mix(a ^ HASH_K1, b ^ h);
+    return hash_mix(h ^ HASH_K2, size ^ HASH_K1);
+}
+
+/// Hashes a single integer.
+///
+inline u64 hash_u64(u64 v) {
+    return hash_mix(v ^ HASH_K0, HASH_K1);
+}
+
+/// The hash used by the hash tables for keys of type T.
+/// Specialize it to hash other types.
+///
+template<typename T, typename = void>
+struct Hash;
+
+template<typename T>
+struct Hash<T, std::enable_if_t<std::is_integral_v<T> ||
+                                std::is_enum_v<T>     ||
+                                std::is_pointer_v<T>>> {
+    u64 operator()(T v) const {
+        if constexpr (std::is_pointer_v<T>)
+            return hash_u64((u64) (uintptr_t) v);
+        else
+            return hash_u64((u64) v);
+    }
+};
+
+template<>
+struct Hash<std::string_view> {
+    u64 operator()(std::string_view s) const {
+        return hash_bytes(s.data(), s.size());
+    }
+};
+
+template<>
+struct Hash<std::string> {
+    u64 operator()(const std::string& s) const {
+        return hash_bytes(s.data(), s.size());
+    }
+};
+}
+
+#endif
@@ -0,0 +1,569 @@
+//===---------------------------------------------------------===
+//
+// Open addressing hash maps and sets which store their entries
+// in one flat array.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_HASH_MAP_H
+#define SSC_HASH_MAP_H
+
+#include "List.h"
+#include "Hash.h"
+
+#include <functional> // for std::equal_to
+
+#if SSC_SIMD_X86
+#include <emmintrin.h>
+#endif
+
+namespace ssc {
+
+/// The control byte of a slot which has never been used.
+constexpr i8 CTRL_EMPTY=-128;
+/// The control byte of a slot whose entry was erased.
+constexpr i8 CTRL_DELETED=-2;
+
+/// A mask with one bit for every slot of a group
+/// matching a control byte.
+///
+class GroupMask {
+public:
+    explicit GroupMask(u32 mask) : mask(mask) {}
+
+    explicit operator bool() const { return mask != 0; }
+
+    /// Get the index of the lowest matching slot.
+    ///
+    u32 lowest() const { return (u32) std::countr_zero(mask); }
+
+    /// Iterates the indices of the matching slots.
+    ///
+    GroupMask& operator++() { mask &= mask-1; return *this; }
+    u32 operator*() const { return lowest(); }
+    GroupMask begin() const { return *this; }
+    GroupMask end() const { return GroupMask(0); }
+    bool operator!=(const GroupMask& rhs) const { return mask != rhs.mask; }
+
+private:
+    u32 mask;
+};
+
+/// The control bytes of 16 consecutive slots which are all
+/// compared against a byte at once.
+///
+class Group {
+public:
+    static constexpr ulen WIDTH=16;
+
+    explicit Group(const i8* ctrl) {
+#if SSC_SIMD_X86
+        bytes=_mm_loadu_si128((const __m128i*) ctrl);
+#else
+        memcpy(bytes, ctrl, WIDTH);
+#endif
+    }
+
+    /// Get the slots whose control byte is `h2`.
+    ///
+    GroupMask match(i8 h2) const {
+#if SSC_SIMD_X86
+        return GroupMask((u32) _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+#else
+        u32 mask=0;
+        for (u32 i=0; i < WIDTH; ++i)
+            mask |= (u32) (bytes[i] == h2) << i;
+        return GroupMask(mask);
+#endif
+    }
+
+    /// Get the slots which have never been used.
+    ///
+    GroupMask match_empty() const {
+        return match(CTRL_EMPTY);
+    }
+
+    /// Get the slots which have no entry. Both control bytes
+    /// have their sign bit set unlike full slots.
+    ///
+    GroupMask match_empty_or_deleted() const {
+#if SSC_SIMD_X86
+        return GroupMask((u32) _mm_movemask_epi8(bytes));
+#else
+        u32 mask=0;
+        for (u32 i=0; i < WIDTH; ++i)
+            mask |= (u32) (bytes[i] < 0) << i;
+        return GroupMask(mask);
+#endif
+    }
+
+private:
+#if SSC_SIMD_X86
+    __m128i bytes;
+#else
+    i8 bytes[WIDTH];
+#endif
+};
+
+/// The table shared by HashMap and HashSet.
+///
+/// Each slot has a control byte holding 7 bits of the hash of
+/// its key, or marking it as empty or deleted. The control
+/// bytes are probed a group at a time with SIMD so a lookup
+/// usually compares a single key. Groups are probed
+/// quadratically and the table grows at 7/8 full.
+///
+/// `KeyOf` gets the key of an entry. `HashFn` and `Eq` may
+/// have state, such as a pointer to where the keys are stored,
+/// in which case they are given to the constructor.
+///
+template<typename Entry, typename Key, typename KeyOf,
+         typename HashFn, typename Eq, typename Allocator>
+class HashTable {
+private:
+    static constexpr bool ALLOC_BY_REF=HOLD_ALLOCATOR_BY_REF<Allocator>;
+    static constexpr ulen WIDTH=Group::WIDTH;
+
+    i8*    ctrl=nullptr;
+    Entry* slots=nullptr;
+    ulen   capacity=0;
+    ulen   csize=0;
+      // Entries which can be added before growing. Deleted
+      // slots count against it until they are reused or
+      // the table is rehashed.
+    ulen   growth_left=0;
+
+    [[no_unique_address]] HashFn hash_fn;
+    [[no_unique_address]] Eq     eq;
+
+    [[no_unique_address]]
+    std::conditional_t<ALLOC_BY_REF, Allocator*, Allocator> allocator;
+
+    static u64 h1(u64 hash) { return hash >> 7; }
+    static i8 h2(u64 hash) { return (i8) (hash & 0x7f); }
+
+    static ulen max_load(ulen capacity) {
+        return capacity - capacity/8;
+    }
+
+    static ulen ctrl_size(ulen capacity) {
+        return (capacity + alignof(Entry)-1) & ~(alignof(Entry)-1);
+    }
+
+    static auto get_allocator_storage(Allocator& allocator) {
+        if constexpr (ALLOC_BY_REF)
+            return &allocator;
+        else
+            return allocator;
+    }
+
+      // Whether memory allocated by either table may be
+      // freed by the other.
+    bool same_allocator(const HashTable& rhs) const {
+        if constexpr (ALLOC_BY_REF)
+            return allocator == rhs.allocator;
+        else
+            return std::is_empty_v<Allocator>;
+    }
+
+    void alloc_table(ulen new_capacity) {
+        char* block = (char*) get_allocator().alloc(ctrl_size(new_capacity) +
+                                                    new_capacity * sizeof(Entry));
+        ctrl        = (i8*) block;
+        slots       = (Entry*) (block + ctrl_size(new_capacity));
+        capacity    = new_capacity;
+        growth_left = max_load(new_capacity);
+        memset(ctrl, CTRL_EMPTY, new_capacity);
+    }
+
+    void free_table() {
+        if (ctrl)
+            get_allocator().free(ctrl);
+    }
+
+    void destroy_entries() {
+        if constexpr (!std::is_trivially_destructible_v<Entry>) {
+            for (ulen i=0; i < capacity; ++i)
+                if (ctrl[i] >= 0)
+                    slots[i].~Entry();
+        }
+    }
+
+      // Gets the slot of a key whose hash is `hash`,
+      // or -1 if it is not in the table.
+    template<typename Q>
+    ulen find_slot(const Q& key, u64 hash) const {
+        if (!capacity)
+            return (ulen) -1;
+        ulen mask  = capacity-1;
+        ulen group = h1(hash) & mask & ~(WIDTH-1);
+        for (ulen step=WIDTH;; step += WIDTH) {
+            Group g(ctrl + group);
+            for (u32 i : g.match(h2(hash))) {
+                if (eq(KeyOf()(slots[group+i]), key))
+                    return group+i;
+            }
+            if (g.match_empty())
+                return (ulen) -1;
+            group = (group + step) & mask;
+        }
+    }
+
+      // Gets an empty slot for a key whose hash is `hash`.
+    ulen find_insert_slot(u64 hash) const {
+        ulen mask  = capacity-1;
+        ulen group = h1(hash) & mask & ~(WIDTH-1);
+        for (ulen step=WIDTH;; step += WIDTH) {
+            if (GroupMask m=Group(ctrl + group).match_empty_or_deleted())
+                return group + m.lowest();
+            group = (group + step) & mask;
+        }
+    }
+
+      // Moves the entries into a table of the new capacity
+      // dropping the deleted slots.
+    void rehash(ulen new_capacity) {
+        i8*    old_ctrl     = ctrl;
+        Entry* old_slots    = slots;
+        ulen   old_capacity = capacity;
+        alloc_table(new_capacity);
+        for (ulen i=0; i < old_capacity; ++i) {
+            if (old_ctrl[i] < 0)
+                continue;
+            u64  hash = hash_fn(KeyOf()(old_slots[i]));
+            ulen slot = find_insert_slot(hash);
+            ctrl[slot] = h2(hash);
+            List<Entry>::relocate(slots+slot, old_slots+i, 1);
+        }
+        growth_left -= csize;
+        if (old_ctrl)
+            get_allocator().free(old_ctrl);
+    }
+
+    void make_room() {
+        if (capacity && csize < max_load(capacity)/2)
+            // Mostly deleted slots, clean them out.
+            rehash(capacity);
+        else
+            rehash(capacity ? capacity*2 : WIDTH);
+    }
+
+public:
+    ~HashTable() {
+        destroy_entries();
+        free_table();
+    }
+    HashTable() requires (!ALLOC_BY_REF) = default;
+    explicit HashTable(Allocator& allocator) :
+        allocator(get_allocator_storage(allocator))
+    {}
+    HashTable(HashFn hash_fn, Eq eq) requires (!ALLOC_BY_REF) :
+        hash_fn(std::move(hash_fn)),
+        eq(std::move(eq))
+    {}
+    HashTable(HashFn hash_fn, Eq eq, Allocator& allocator) :
+        hash_fn(std::move(hash_fn)),
+        eq(std::move(eq)),
+        allocator(get_allocator_storage(allocator))
+    {}
+      // copy constructor, the copy uses the same allocator.
+    HashTable(const HashTable& rhs) :
+        hash_fn(rhs.hash_fn),
+        eq(rhs.eq),
+        allocator(rhs.allocator)
+    {
+        reserve(rhs.csize);
+        for (const Entry& entry : rhs)
+            insert(entry);
+    }
+      // move constructor
+    HashTable(HashTable&& rhs) noexcept :
+        ctrl(std::exchange(rhs.ctrl, nullptr)),
+        slots(std::exchange(rhs.slots, nullptr)),
+        capacity(std::exchange(rhs.capacity, 0)),
+        csize(std::exchange(rhs.csize, 0)),
+        growth_left(std::exchange(rhs.growth_left, 0)),
+        hash_fn(rhs.hash_fn),
+        eq(rhs.eq),
+        allocator(rhs.allocator)
+    {}
+      // copy assignment, keeps the allocator of this table.
+    HashTable& operator=(const HashTable& rhs) {
+        if (this == &rhs) return *this;
+        clear();
+        hash_fn = rhs.hash_fn;
+        eq      = rhs.eq;
+        reserve(rhs.csize);
+        for (const Entry& entry : rhs)
+            insert(entry);
+        return *this;
+    }
+      // move assignment, keeps the allocator of this table.
+    HashTable& operator=(HashTable&& rhs) noexcept {
+        if (this == &rhs) return *this;
+        hash_fn = rhs.hash_fn;
+        eq      = rhs.eq;
+
+        if (same_allocator(rhs)) {
+            // The memory can simply be taken over.
+            destroy_entries();
+            free_table();
+            ctrl        = std::exchange(rhs.ctrl, nullptr);
+            slots       = std::exchange(rhs.slots, nullptr);
+            capacity    = std::exchange(rhs.capacity, 0);
+            csize       = std::exchange(rhs.csize, 0);
+            growth_left = std::exchange(rhs.growth_left, 0);
+            return *this;
+        }
+
+        // Otherwise the entries are moved into memory of
+        // this table's allocator.
+        clear();
+        reserve(rhs.csize);
+        for (Entry& entry : rhs)
+            insert(std::move(entry));
+        rhs.clear();
+        return *this;
+    }
+
+    /// Iterates the entries of the table in no
+    /// particular order.
+    ///
+    template<typename E>
+    class Iterator {
+    private:
+        const i8* ctrl;
+        const i8* ctrl_end;
+        E*        slot;
+
+        void skip_free() {
+            while (ctrl != ctrl_end && *ctrl < 0)
+                ++ctrl, ++slot;
+        }
+
+    public:
+        Iterator(const i8* ctrl, const i8* ctrl_end, E* slot) :
+            ctrl(ctrl), ctrl_end(ctrl_end), slot(slot)
+        {
+            skip_free();
+        }
+
+        E& operator*() const { return *slot; }
+        E* operator->() const { return slot; }
+        Iterator& operator++() {
+            ++ctrl, ++slot;
+            skip_free();
+            return *this;
+        }
+        bool operator==(const Iterator& rhs) const { return ctrl == rhs.ctrl; }
+        bool operator!=(const Iterator& rhs) const { return ctrl != rhs.ctrl; }
+    };
+
+    Iterator<Entry> begin() { return Iterator<Entry>(ctrl, ctrl+capacity, slots); }
+    Iterator<Entry> end() { return Iterator<Entry>(ctrl+capacity, ctrl+capacity, slots+capacity); }
+    Iterator<const Entry> begin() const { return Iterator<const Entry>(ctrl, ctrl+capacity, slots); }
+    Iterator<const Entry> end() const { return Iterator<const Entry>(ctrl+capacity, ctrl+capacity, slots+capacity); }
+
+    /// Get the allocator the table allocates its memory with.
+    ///
+    Allocator& get_allocator() {
+        if constexpr (ALLOC_BY_REF)
+            return *allocator;
+        else
+            return allocator;
+    }
+
+    /// Get the number of entries in the table.
+    ///
+    ulen size() const { return csize; }
+
+    /// Whether the table has no entries.
+    ///
+    bool empty() const { return csize == 0; }
+
+    /// Find the entry of a key.
+    ///
+    /// `key` may be of any type `HashFn` and `Eq` accept which
+    /// allows looking up keys without constructing one.
+    ///
+    /// \return nullptr if there is no entry.
+    ///
+    template<typename Q>
+    Entry* find(const Q& key) {
+        return find(key, hash_fn(key));
+    }
+    template<typename Q>
+    const Entry* find(const Q& key) const {
+        return const_cast<HashTable*>(this)->find(key);
+    }
+
+    /// Find the entry of a key whose hash is already known.
+    ///
+    template<typename Q>
+    Entry* find(const Q& key, u64 hash) {
+        ulen slot = find_slot(key, hash);
+        return slot == (ulen) -1 ? nullptr : slots+slot;
+    }
+
+    /// Whether there is an entry for the key.
+    ///
+    template<typename Q>
+    bool contains(const Q& key) const {
+        return find(key) != nullptr;
+    }
+
+    /// Find the entry of a key or construct one from `args`
+    /// if there is none.
+    ///
+    /// \return the entry and whether it was constructed.
+    ///
+    template<typename... Args>
+    std::pair<Entry*, bool> emplace(const Key& key, Args&&... args) {
+        u64 hash = hash_fn(key);
+        if (Entry* entry = find(key, hash))
+            return { entry, false };
+        if (growth_left == 0)
+            make_room();
+        ulen slot = find_insert_slot(hash);
+        if (ctrl[slot] == CTRL_EMPTY)
+            --growth_left;
+        ctrl[slot] = h2(hash);
+        ::new (slots+slot) Entry(std::forward<Args>(args)...);
+        ++csize;
+        return { slots+slot, true };
+    }
+
+    /// Insert a copy of the entry if its key has no entry.
+    ///
+    std::pair<Entry*, bool> insert(const Entry& entry) {
+        return emplace(KeyOf()(entry), entry);
+    }
+    std::pair<Entry*, bool> insert(Entry&& entry) {
+        const Key& key = KeyOf()(entry);
+        return emplace(key, std::move(entry));
+    }
+
+    /// Remove the entry of a key.
+    ///
+    /// \return whether there was an entry.
+    ///
+    template<typename Q>
+    bool erase(const Q& key) {
+        Entry* entry = find(key);
+        if (!entry)
+            return false;
+        erase(entry);
+        return true;
+    }
+
+    /// Remove an entry of the table.
+    ///
+    void erase(Entry* entry) {
+        ulen slot  = entry - slots;
+        ulen group = slot & ~(WIDTH-1);
+        entry->~Entry();
+        --csize;
+        // Probes stop at a group with an empty slot so the slot
+        // only needs to be marked deleted if the group is full.
+        if (Group(ctrl + group).match_empty()) {
+            ctrl[slot] = CTRL_EMPTY;
+            ++growth_left;
+        } else
+            ctrl[slot] = CTRL_DELETED;
+    }
+
+    /// Reserves room for at least `size` entries
+    /// without rehashing.
+    ///
+    void reserve(ulen size) {
+        if (size <= csize + growth_left)
+            return;
+        ulen new_capacity = WIDTH;
+        while (max_load(new_capacity) < size)
+            new_capacity <<= 1;
+        rehash(new_capacity);
+    }
+
+    /// Removes all the entries but keeps the memory.
+    ///
+    void clear() {
+        destroy_entries();
+        if (ctrl)
+            memset(ctrl, CTRL_EMPTY, capacity);
+        csize = 0;
+        growth_left = max_load(capacity);
+    }
+};
+
+/// An entry of a HashMap.
+///
+template<typename K, typename V>
+struct HashMapEntry {
+    K key;
+    V value;
+};
+
+template<typename K, typename V>
+struct HashMapKeyOf {
+    const K& operator()(const HashMapEntry<K, V>& entry) const { return entry.key; }
+};
+
+template<typename K>
+struct HashSetKeyOf {
+    const K& operator()(const K& key) const { return key; }
+};
+
+/// A hash map from `K` to `V` storing its entries inline in
+/// a flat table. Inserting or erasing may move entries so
+/// pointers to entries are only valid until then.
+///
+template<typename K, typename V, typename HashFn = Hash<K>,
+         typename Eq = std::equal_to<>, typename Allocator = DynAllocator>
+class HashMap : public HashTable<HashMapEntry<K, V>, K, HashMapKeyOf<K, V>,
+                                 HashFn, Eq, Allocator> {
+private:
+    using Base = HashTable<HashMapEntry<K, V>, K, HashMapKeyOf<K, V>,
+                           HashFn, Eq, Allocator>;
+public:
+    using Entry = HashMapEntry<K, V>;
+    using Base::Base;
+
+    /// Get the value of a key or nullptr if there is none.
+    ///
+    template<typename Q>
+    V* get(const Q& key) {
+        Entry* entry = Base::find(key);
+        return entry ? &entry->value : nullptr;
+    }
+
+    /// Set the value of a key replacing any value
+    /// it already had.
+    ///
+    V& set(const K& key, V value) {
+        if (Entry* entry = Base::find(key)) {
+            entry->value = std::move(value);
+            return entry->value;
+        }
+        return Base::emplace(key, key, std::move(value)).first->value;
+    }
+
+    /// Get the value of a key default constructing it
+    /// if there is none.
+    ///
+    V& operator[](const K& key) {
+        return Base::emplace(key, key).first->value;
+    }
+};
+
+/// A hash set of `K` storing its keys inline in a flat table.
+///
+template<typename K, typename HashFn = Hash<K>,
+         typename Eq = std::equal_to<>, typename Allocator = DynAllocator>
+class HashSet : public HashTable<K, K, HashSetKeyOf<K>, HashFn, Eq, Allocator> {
+private:
+    using Base = HashTable<K, K, HashSetKeyOf<K>, HashFn, Eq, Allocator>;
+public:
+    using Base::Base;
+};
+}
+
+#endif
@@ -4,246 +4,311 @@
 // array.
 //
 //===---------------------------------------------------------===
-
-#include "mem.h"
-
 #ifndef SSC_LIST_H
 #define SSC_LIST_H
 
 #include <memory>
+#include <utility>   // for std::exchange
+#include <cstring>   // for memcpy, memmove
+#include <algorithm> // for std::find, std::equal
+#include <type_traits>
+#include <iterator>  // for std::begin, std::distance
+#include <bit>       // for std::bit_cast
 #include "core_types.h"
 #include "sys.h"
+#include "simd.h"
 
 namespace ssc {
 
 // Forward declaring because mem.h relies on List.h
 ulen next_pow_of2(ulen);
+class DynAllocator;
+
+/// Whether objects of type T may be moved to another address
+/// by copying their bytes, after which the old bytes are simply
+/// forgotten instead of destroyed. This holds for trivially
+/// copyable types and for most types which own memory through
+/// pointers, but not for types which point into themselves such
+/// as std::string with its small string buffer.
+///
+/// Types opt in by specializing this trait or by declaring
+/// a member `using TriviallyRelocatable = void;`.
+///
+template<typename T>
+struct IsTriviallyRelocatable : std::bool_constant<
+    std::is_trivially_copyable_v<T> ||
+    requires { typename T::TriviallyRelocatable; }
+> {};
+
+template<typename T>
+constexpr bool is_trivially_relocatable_v=IsTriviallyRelocatable<T>::value;
+
+/// Whether equality of T is equality of its bytes and T is
+/// the size of an integer, so searches can compare many
+/// elements at once.
+///
+template<typename T>
+constexpr bool IS_SIMD_COMPARABLE=(std::is_integral_v<T> ||
+                                   std::is_enum_v<T>     ||
+                                   std::is_pointer_v<T>) &&
+                                  !std::is_same_v<std::remove_cv_t<T>, bool> &&
+                                  (sizeof(T) == 1 || sizeof(T) == 2 ||
+                                   sizeof(T) == 4 || sizeof(T) == 8);
+
+template<ulen SIZE> struct SimdLane;
+template<> struct SimdLane<1> { using Type = u8;  };
+template<> struct SimdLane<2> { using Type = u16; };
+template<> struct SimdLane<4> { using Type = u32; };
+template<> struct SimdLane<8> { using Type = u64; };
+
+/// Below this many elements a search is a plain loop, since
+/// calling the vectorized kernel through its runtime dispatch
+/// costs more than comparing them one by one.
+///
+constexpr ulen SIMD_SEARCH_MIN=16;
+
+/// Get the first of `count` elements equal to `elm`, comparing
+/// many elements at once where IS_SIMD_COMPARABLE<T> and there
+/// are at least SIMD_SEARCH_MIN elements.
+///
+/// \return `elms + count` if no element is equal.
+///
+template<typename T>
+T* find_elm(T* elms, ulen count, const std::type_identity_t<T>& elm) {
+    if constexpr (IS_SIMD_COMPARABLE<T>) {
+        if (count < SIMD_SEARCH_MIN) {
+            for (ulen i=0; i < count; ++i) {
+                if (elms[i] == elm)
+                    return elms + i;
+            }
+            return elms + count;
+        }
+        using Lane = typename SimdLane<sizeof(T)>::Type;
+        return elms + simd_find((const Lane*) elms, count,
+                                std::bit_cast<Lane>(elm));
+    } else
+        return std::find(elms, elms + count, elm);
+}
 
-template<typename T, typename Allocator = DynAllocator>
-class List {
-private:
-    ulen capacity;
-    ulen csize;
-    T*   buckets;
-    
-    Allocator allocator;
+/// Get the number of the `count` elements equal to `elm`.
+///
+template<typename T>
+ulen count_elms(const T* elms, ulen count, const T& elm) {
+    if constexpr (IS_SIMD_COMPARABLE<T>) {
+        if (count < SIMD_SEARCH_MIN) {
+            ulen n=0;
+            for (ulen i=0; i < count; ++i)
+                n += elms[i] == elm;
+            return n;
+        }
+        using Lane = typename SimdLane<sizeof(T)>::Type;
+        return simd_count((const Lane*) elms, count,
+                          std::bit_cast<Lane>(elm));
+    } else
+        return std::count(elms, elms + count, elm);
+}
 
-    void free_buckets(T* old_buckets) {
-        allocator.free(old_buckets);
-    }
+/// Whether the `count` elements of both arrays are equal.
+///
+template<typename T>
+bool equal_elms(const T* lhs, const T* rhs, ulen count) {
+    if constexpr (IS_SIMD_COMPARABLE<T>)
+        // memcmp is already vectorized.
+        return count == 0 || memcmp(lhs, rhs, count * sizeof(T)) == 0;
+    else
+        return std::equal(lhs, lhs + count, rhs);
+}
 
-    void alloc_buckets(ulen new_capacity) {
-        buckets = (T*) allocator.alloc(new_capacity * sizeof(T));
-        capacity = new_capacity;
-    }
-        
-      // Deallocates the existing buckets and creates new
-      // buckets without copying over the old elements.
-    void alloc_new_buckets(ulen new_capacity) {
-        if (capacity >= new_capacity)
-            return;
-        T* old_buckets = buckets;
-        alloc_buckets(new_capacity);
-        free_buckets(old_buckets);
+/// Allocators which cannot be copied, such as the arenas, own
+/// memory on behalf of many collections so a list only holds
+/// a reference to them. Copyable allocators are handles or are
+/// stateless and are held by value.
+///
+template<typename Allocator>
+constexpr bool HOLD_ALLOCATOR_BY_REF=!std::is_copy_constructible_v<Allocator>;
+
+/// The operations on the elements of a list which List and
+/// SmallList share, so they only differ in how they store their
+/// elements.
+///
+/// `Derived` owns the storage. It has the members `buckets`,
+/// `csize` and `capacity`, where the size and capacity may be
+/// any unsigned type, and changes the capacity keeping the
+/// elements with `realloc_buckets(new_capacity)`.
+///
+template<typename Derived, typename T>
+class ListBase {
+protected:
+    static constexpr bool RELOCATABLE=is_trivially_relocatable_v<T>;
+
+    Derived& self() { return static_cast<Derived&>(*this); }
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+
+    void set_size(ulen size) {
+        self().csize = (decltype(self().csize)) size;
     }
 
     void grow() {
-         if (capacity == 0) {
-            // first allocation!
-            alloc_buckets(1);
-        } else {
-            T* old_buckets=buckets;
-            alloc_buckets(capacity << 1);
-            // Should be safe to use memcpy here since we are now in control
-            // of the memory of the buckets.
-            memcpy(buckets, old_buckets, csize * sizeof(T));
-            free_buckets(old_buckets);
-        }
-
+        ulen capacity=self().capacity;
+        self().realloc_buckets(capacity == 0 ? 1 : capacity << 1);
     }
-    
+
     void destroy_range(T* p, T* e) {
         while (p != e)
             p->~T(), ++p;
     }
-    
+
     void check_bounds(const T* itr) const {
-        if (itr < buckets || itr >= buckets+csize)
+        if (itr < begin() || itr >= end())
             DBG_PANIC("list out of bounds");
     }
 
 public:
 
-    ~List() {
-        if constexpr (!std::is_trivially_destructible_v<T>)
-            destroy_range(begin(), end());
-        free_buckets(buckets);
-    }
-    List(Allocator&& allocator = {}) :
-        capacity(0), csize(0), buckets(nullptr),
-        allocator(allocator)
-    {}
-    List(std::initializer_list<T> il) {
-        alloc_buckets(next_pow_of2(il.size()));
-        if constexpr (std::is_trivially_copyable_v<T>)
-            memcpy(begin(), il.begin(), il.size() * sizeof(T));
-        else
-            std::uninitialized_copy(il.begin(), il.end(), begin());
-        csize = il.size();
-    }
-      // copy constructor
-    List(const List& rhs) {
-        if (!rhs.empty()) {
-            alloc_buckets(next_pow_of2(rhs.size()));
-            if constexpr (std::is_trivially_copyable_v<T>)
-                memcpy(begin(), rhs.begin(), rhs.csize * sizeof(T));
-            else
-                std::uninitialized_copy(rhs.begin(), rhs.end(), begin());
-        }
-        csize = rhs.csize;
-    }
-      // move constructor
-    List(List&& rhs) noexcept :
-        csize(std::exchange(rhs.csize, 0)),
-        capacity(std::exchange(rhs.capacity, 0)),
-        buckets(std::exchange(rhs.buckets, nullptr)),
-        allocator(std::exchange(rhs.allocator, {}))
-    {}
-     // copy assignment
-    List& operator=(const List& rhs) {
-          // avoid self-assignment.
-        if (this == &rhs) return *this;
-
-        if constexpr (std::is_trivially_copyable_v<T>) {
-            // Trivially copyable so we can use memcpy.
-            // 
-            // NOTE: No need to call destructors here because
-            // trivially copyable types are also trivially
-            // destructible.
-
-            // Expand the memory size if we need to.
-            if (capacity < rhs.size())
-               alloc_new_buckets(next_pow_of2(rhs.size()));
-            
-            memcpy(begin(), rhs.begin(), rhs.size() * sizeof(T));
-            csize = rhs.size();
-            return *this;
-        }
-
-        // Unfortunate, got to use copy constructors!
-
-        // Checking if there is already enough pre-created elements
-        // such that the elements can just be copied into the existing
-        // elements.
-        if (csize >= rhs.size()) {
-            T* new_end = rhs.size() > 0
-                       ? std::copy(rhs.begin(), rhs.end(), begin())
-                       : begin();
-            // Destroy the excess elements.
-            destroy_range(new_end, end());
-
-            csize = rhs.size();
-            return *this;
+    /// Moves `count` elements into uninitialized memory at `dst`
+    /// leaving the memory at `src` uninitialized. The ranges may
+    /// overlap.
+    ///
+    /// Other containers of T use this to move their elements
+    /// the same way a list does.
+    ///
+    static void relocate(T* dst, T* src, ulen count) {
+        if constexpr (RELOCATABLE) {
+            if (count)
+                memmove((void*) dst, (const void*) src, count * sizeof(T));
+        } else if (dst < src) {
+            for (T* e=src+count; src != e; ++src, ++dst) {
+                ::new (dst) T(std::move(*src));
+                src->~T();
+            }
+        } else {
+            for (T* p=src+count, *d=dst+count; p != src;) {
+                --p, --d;
+                ::new (d) T(std::move(*p));
+                p->~T();
+            }
         }
-
-        // Checking to see if we need to expand our memory capacity.
-        if (capacity < rhs.size())
-            alloc_new_buckets(next_pow_of2(rhs.size()));
-        else
-            // Otherwise, going to copy to the existing elements.
-            std::copy(rhs.begin(), rhs.begin()+csize, begin());
-
-        // Now going to copy over the elements for the uninitialized memory.
-        std::uninitialized_copy(rhs.begin()+csize, rhs.end(), begin()+csize);
-
-        csize = rhs.size();
-        return *this;
-    }
-      // move assignment
-    List& operator=(List&& rhs) noexcept {
-          // Avoid self-assignment.
-        if (this == &rhs) return *this;
-
-        // Checking if there is already enough pre-created elements
-        // such that the memory can just be moved into the existing
-        // elements.
-        if (csize >= rhs.csize) {
-            T* new_end = rhs.csize > 0
-                       ? std::move(rhs.begin(), rhs.end(), begin())
-                       : begin();
-            // Destroy the excess elements.
-            destroy_range(new_end, end());
-
-            csize = rhs.size();
-            rhs.clear();
-            return *this;
-        }
-        
-        // Checking to see if we need to expand our memory capacity.
-        if (capacity < rhs.size())
-            alloc_new_buckets(next_pow_of2(rhs.size()));
-        else
-            // Otherwise, going to copy to the existing elements.
-            std::move(rhs.begin(), rhs.begin()+csize, begin());
-        
-        // Now going to move over the elements for the uninitialized memory.
-        std::uninitialized_move(rhs.begin()+csize, rhs.end(), begin()+csize);
-        
-        csize = rhs.csize;
-        return *this;
     }
 
     /// Get the number of elements in this list.
-    ulen size() const { return csize; }
+    ulen size() const { return self().csize; }
 
     /// Does this list contain no elements.
-    bool empty() const { return csize == 0; }
+    bool empty() const { return self().csize == 0; }
 
       // begin/end iterators
-    T* begin() { return buckets;         }
-    T* end()   { return buckets + csize; }
+    T* begin() { return self().buckets;          }
+    T* end()   { return begin() + self().csize; }
       // begin/end const iterators
-    const T* begin() const { return buckets;         }
-    const T* end()   const { return buckets + csize; }
+    const T* begin() const { return self().buckets;          }
+    const T* end()   const { return begin() + self().csize; }
     
     /// Get the first element in the list.
     ///
     T& front() {
         DBG_ASSERT(!empty(), "cannot call front() on empty list");
-        return *buckets;
+        return *begin();
     }
     const T& front() const {
         DBG_ASSERT(!empty(), "cannot call front() on empty list");
-        return *buckets;
+        return *begin();
     }
 
     /// Get the last element in the list.
     ///
     T& back() {
         DBG_ASSERT(!empty(), "cannot call back() on empty list");
-        return *(buckets + csize - 1);
+        return *(end() - 1);
     }
     const T& back() const {
         DBG_ASSERT(!empty(), "cannot call back() on empty list");
-        return *(buckets + csize - 1);
+        return *(end() - 1);
     }
 
     /// Append the element to the end of the list and
     /// allocate memory is needed.
     ///
     void add(T&& elm) {
-       if (csize == capacity) grow();
+       if (size() == self().capacity) grow();
        ::new (end()) T(std::move(elm));
-       ++csize;
+       ++self().csize;
     }
 
     /// Append the element to the end of the list and
     /// allocate memory is needed.
     ///
     void add(const T& elm) {
-        if (csize == capacity) grow();
+        if (size() == self().capacity) grow();
         ::new (end()) T(elm);
-        ++csize;
+        ++self().csize;
+    }
+
+    /// Constructs an element in place at the end of the list
+    /// and allocate memory is needed.
+    ///
+    template<typename... Args>
+    T& emplace(Args&&... args) {
+        if (size() == self().capacity) grow();
+        T* elm = ::new (end()) T(std::forward<Args>(args)...);
+        ++self().csize;
+        return *elm;
+    }
+
+    /// Append all the elements of the range to the end of the
+    /// list allocating at most once.
+    ///
+    template<typename Range>
+    void append_range(const Range& range) {
+        insert_range(end(), range);
+    }
+
+    /// Inserts all the elements of the range before `pos`,
+    /// shifting the elements after it only once.
+    ///
+    /// NOTE: The range must not be elements of this list.
+    ///
+    /// \return a pointer to the first inserted element.
+    ///
+    template<typename Range>
+    T* insert_range(T* pos, const Range& range) {
+        if (pos != end())
+            check_bounds(pos);
+        auto first = std::begin(range);
+        auto last  = std::end(range);
+        ulen count = (ulen) std::distance(first, last);
+        ulen idx   = pos - begin();
+        reserve(size() + count);
+        T* at = begin() + idx;
+        relocate(at + count, at, size() - idx);
+        std::uninitialized_copy(first, last, at);
+        set_size(size() + count);
+        return at;
+    }
+
+    /// Removes all the elements matching the predicate in
+    /// a single pass keeping the order of the rest.
+    ///
+    /// \return the number of elements removed.
+    ///
+    template<class P>
+    ulen erase_if(P predicate) {
+        T* new_end = std::remove_if(begin(), end(), predicate);
+        ulen removed = end() - new_end;
+        destroy_range(new_end, end());
+        set_size(size() - removed);
+        return removed;
+    }
+
+    /// Removes the element by moving the last element into
+    /// its place, which does not keep the order of the list.
+    ///
+    void swap_remove(T* itr) {
+        check_bounds(itr);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            itr->~T();
+        if (itr != end()-1)
+            relocate(itr, end()-1, 1);
+        --self().csize;
     }
 
     /// Try and find a matching element in the list.
@@ -251,7 +316,22 @@ public:
     /// \return this->end() if no element is found.
     ///
     T* find(const T& elm) {
-        return std::find(begin(), end(), elm);
+        return find_elm(begin(), size(), elm);
+    }
+    const T* find(const T& elm) const {
+        return find_elm(begin(), size(), elm);
+    }
+
+    /// Whether a matching element is in the list.
+    ///
+    bool contains(const T& elm) const {
+        return find(elm) != end();
+    }
+
+    /// Get the number of matching elements in the list.
+    ///
+    ulen count(const T& elm) const {
+        return count_elms(begin(), size(), elm);
     }
     template<class P>
     T* find_if(P predicate) {
@@ -260,18 +340,20 @@ public:
     
     T& operator[](ulen idx) {
         check_bounds(begin() + idx);
-        return buckets[idx];
+        return begin()[idx];
     }
     const T& operator[](ulen idx) const {
         check_bounds(begin() + idx);
-        return buckets[idx];
+        return begin()[idx];
     }
 
-    bool operator==(const List& rhs) const {
-        if (csize != rhs.csize) return false;
-        return std::equal(begin(), end(), rhs.begin());
+    bool operator==(const Derived& rhs) const {
+        if (size() != rhs.size()) return false;
+        return equal_elms(begin(), rhs.begin(), size());
+    }
+    bool operator!=(const Derived& rhs) const {
+        return !(*this == rhs);
     }
-    bool operator!=(const List& rhs) const = default;
 
     /// Removes the element at the given index.
     ///
@@ -286,11 +368,10 @@ public:
         check_bounds(itr);
         if constexpr (!std::is_trivially_destructible_v<T>)
             itr->~T();
-        if (itr != (end()-1))
-            // Shift all the elements down to fill the whole
-            // of the removed element.
-            memcpy(itr, itr+1, ((end()-1)-itr) * sizeof(T));
-        --csize;
+        // Shift all the elements down to fill the hole
+        // of the removed element.
+        relocate(itr, itr+1, (end()-1)-itr);
+        --self().csize;
     }
 
     /// Removes the last element of the list.
@@ -299,7 +380,7 @@ public:
         DBG_ASSERT(!empty(), "cannot pop an empty list");
         if constexpr (!std::is_trivially_destructible_v<T>)
             (end()-1)->~T();
-        --csize;
+        --self().csize;
     }
 
     /// Removes `n` elements from the end of the list.
@@ -308,7 +389,7 @@ public:
         check_bounds(end() - n);
         if constexpr (!std::is_trivially_destructible_v<T>)
             destroy_range(end()-n, end());
-        csize -= n;
+        set_size(size() - n);
     }
 
     /// Removes the first element of the list.
@@ -322,8 +403,8 @@ public:
     void pop_front_n(ulen n) {
         check_bounds(begin()+n-1);
         destroy_range(begin(), begin()+n);
-        memcpy(begin(), begin()+n, (csize-n) * sizeof(T));
-        csize -= n;
+        relocate(begin(), begin()+n, size()-n);
+        set_size(size() - n);
     }
 
     /// Reserves memory of at least `size`.
@@ -333,30 +414,23 @@ public:
     /// the size, use resize().
     ///
     void reserve(ulen size) {
-        if (capacity < size) {
-            T* old_buckets = buckets;
-            alloc_buckets(next_pow_of2(size));
-            memcpy(buckets, old_buckets, csize*sizeof(T));
-            free_buckets(old_buckets);
-        }
+        if (self().capacity < size)
+            self().realloc_buckets(next_pow_of2(size));
     }
     
     /// Reserves memory and increases the size of this list.
     ///
     void resize(ulen size) {
         reserve(size);
-        if (size > csize) {
-            ulen diff=size-csize;
+        if (size > this->size()) {
             // Call default constructors.
-            for (T* p=end(), *e=end()+diff; p != e; ++p)
+            for (T* p=end(), *e=begin()+size; p != e; ++p)
                 ::new (p) T();
-        } else if (size < csize) {
-            if constexpr (!std::is_trivially_destructible_v<T>) {
-                ulen diff=csize-size;
-                destroy_range(end(), end()+diff);
-            }
+        } else if (size < this->size()) {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                destroy_range(begin()+size, end());
         }
-        csize = size;
+        set_size(size);
     }
 
     /// Empties the list of all the elements but does not
@@ -364,25 +438,285 @@ public:
     ///
     void clear() {
         destroy_range(begin(), end());
-        csize = 0;
+        self().csize = 0;
+    }
+};
+
+template<typename T, typename Allocator = DynAllocator>
+class List : public ListBase<List<T, Allocator>, T> {
+private:
+    friend class ListBase<List, T>;
+    using Base = ListBase<List, T>;
+    using Base::RELOCATABLE;
+    using Base::destroy_range;
+
+    static constexpr bool ALLOC_BY_REF=HOLD_ALLOCATOR_BY_REF<Allocator>;
+
+    ulen capacity=0;
+    ulen csize=0;
+    T*   buckets=nullptr;
+    
+    [[no_unique_address]]
+    std::conditional_t<ALLOC_BY_REF, Allocator*, Allocator> allocator;
+
+    void free_buckets(T* old_buckets) {
+        get_allocator().free(old_buckets);
+    }
+
+    void alloc_buckets(ulen new_capacity) {
+        buckets = (T*) get_allocator().alloc(new_capacity * sizeof(T));
+        capacity = new_capacity;
+    }
+
+      // Tries to grow the buckets without moving them which arenas
+      // can do when the buckets are their most recent allocation.
+    bool try_extend_buckets(ulen new_capacity) {
+        if constexpr (requires (Allocator& a) { a.try_extend(nullptr, 0, 0); }) {
+            if (buckets && get_allocator().try_extend(buckets,
+                                                      capacity * sizeof(T),
+                                                      new_capacity * sizeof(T))) {
+                capacity = new_capacity;
+                return true;
+            }
+        }
+        return false;
+    }
+        
+      // Deallocates the existing buckets and creates new
+      // buckets without copying over the old elements.
+    void alloc_new_buckets(ulen new_capacity) {
+        if (capacity >= new_capacity)
+            return;
+        if (try_extend_buckets(new_capacity))
+            return;
+        T* old_buckets = buckets;
+        alloc_buckets(new_capacity);
+        free_buckets(old_buckets);
+    }
+
+      // Changes the capacity of the buckets keeping the existing
+      // elements.
+    void realloc_buckets(ulen new_capacity) {
+        if (new_capacity > capacity && try_extend_buckets(new_capacity))
+            return;
+        if constexpr (RELOCATABLE &&
+                      requires (Allocator& a) { a.realloc(nullptr, 0, 0); }) {
+            // The allocator may be able to grow the memory in place or
+            // remap its pages rather than copying the elements.
+            buckets = (T*) get_allocator().realloc(buckets,
+                                                   capacity * sizeof(T),
+                                                   new_capacity * sizeof(T));
+            capacity = new_capacity;
+        } else {
+            T* old_buckets=buckets;
+            alloc_buckets(new_capacity);
+            relocate(buckets, old_buckets, csize);
+            free_buckets(old_buckets);
+        }
+    }
+
+      // Whether memory allocated by either list may be
+      // freed by the other.
+    bool same_allocator(const List& rhs) const {
+        if constexpr (ALLOC_BY_REF)
+            return allocator == rhs.allocator;
+        else
+            return std::is_empty_v<Allocator>;
+    }
+
+    static auto get_allocator_storage(Allocator& allocator) {
+        if constexpr (ALLOC_BY_REF)
+            return &allocator;
+        else
+            return allocator;
+    }
+
+      // Initializes the list with copies of the elements. Only
+      // used by constructors.
+    void init_from(const T* elms, ulen count) {
+        if (!count)
+            return;
+        alloc_buckets(next_pow_of2(count));
+        if constexpr (std::is_trivially_copyable_v<T>)
+            memcpy(begin(), elms, count * sizeof(T));
+        else
+            std::uninitialized_copy(elms, elms+count, begin());
+        csize = count;
+    }
+
+public:
+    using Base::relocate;
+    using Base::begin;
+    using Base::end;
+    using Base::size;
+    using Base::empty;
+    using Base::clear;
+
+    ~List() {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destroy_range(begin(), end());
+        free_buckets(buckets);
+    }
+    List() requires (!ALLOC_BY_REF) = default;
+    explicit List(Allocator& allocator) :
+        allocator(get_allocator_storage(allocator))
+    {}
+    List(std::initializer_list<T> il) requires (!ALLOC_BY_REF) {
+        init_from(il.begin(), il.size());
+    }
+    List(std::initializer_list<T> il, Allocator& allocator) :
+        allocator(get_allocator_storage(allocator))
+    {
+        init_from(il.begin(), il.size());
+    }
+      // copy constructor, the copy uses the same allocator.
+    List(const List& rhs) :
+        Base(),
+        allocator(rhs.allocator)
+    {
+        init_from(rhs.begin(), rhs.size());
+    }
+      // move constructor
+    List(List&& rhs) noexcept :
+        capacity(std::exchange(rhs.capacity, 0)),
+        csize(std::exchange(rhs.csize, 0)),
+        buckets(std::exchange(rhs.buckets, nullptr)),
+        allocator(rhs.allocator)
+    {}
+     // copy assignment, keeps the allocator of this list.
+    List& operator=(const List& rhs) {
+          // avoid self-assignment.
+        if (this == &rhs) return *this;
+
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            // Trivially copyable so we can use memcpy.
+            // 
+            // NOTE: No need to call destructors here because
+            // trivially copyable types are also trivially
+            // destructible.
+
+            // Expand the memory size if we need to.
+            if (capacity < rhs.size())
+               alloc_new_buckets(next_pow_of2(rhs.size()));
+            
+            if (!rhs.empty())
+                memcpy(begin(), rhs.begin(), rhs.size() * sizeof(T));
+            csize = rhs.size();
+            return *this;
+        }
+
+        // Unfortunate, got to use copy constructors!
+
+        // Checking if there is already enough pre-created elements
+        // such that the elements can just be copied into the existing
+        // elements.
+        if (csize >= rhs.size()) {
+            T* new_end = std::copy(rhs.begin(), rhs.end(), begin());
+            // Destroy the excess elements.
+            destroy_range(new_end, end());
+
+            csize = rhs.size();
+            return *this;
+        }
+
+        // Checking to see if we need to expand our memory capacity.
+        if (capacity < rhs.size()) {
+            // The existing elements are of no use in new memory.
+            clear();
+            alloc_new_buckets(next_pow_of2(rhs.size()));
+        } else
+            // Otherwise, going to copy to the existing elements.
+            std::copy(rhs.begin(), rhs.begin()+csize, begin());
+
+        // Now going to copy over the elements for the uninitialized memory.
+        std::uninitialized_copy(rhs.begin()+csize, rhs.end(), begin()+csize);
+
+        csize = rhs.size();
+        return *this;
+    }
+      // move assignment, keeps the allocator of this list.
+    List& operator=(List&& rhs) noexcept {
+          // Avoid self-assignment.
+        if (this == &rhs) return *this;
+
+        if (same_allocator(rhs)) {
+            // The memory can simply be taken over.
+            destroy_range(begin(), end());
+            free_buckets(buckets);
+            capacity = std::exchange(rhs.capacity, 0);
+            csize    = std::exchange(rhs.csize, 0);
+            buckets  = std::exchange(rhs.buckets, nullptr);
+            return *this;
+        }
+
+        // Checking if there is already enough pre-created elements
+        // such that the memory can just be moved into the existing
+        // elements.
+        if (csize >= rhs.csize) {
+            T* new_end = std::move(rhs.begin(), rhs.end(), begin());
+            // Destroy the excess elements.
+            destroy_range(new_end, end());
+
+            csize = rhs.size();
+            rhs.clear();
+            return *this;
+        }
+        
+        // Checking to see if we need to expand our memory capacity.
+        if (capacity < rhs.size()) {
+            // The existing elements are of no use in new memory.
+            clear();
+            alloc_new_buckets(next_pow_of2(rhs.size()));
+        } else
+            // Otherwise, going to move to the existing elements.
+            std::move(rhs.begin(), rhs.begin()+csize, begin());
+        
+        // Now going to move over the elements for the uninitialized memory.
+        std::uninitialized_move(rhs.begin()+csize, rhs.end(), begin()+csize);
+        
+        csize = rhs.csize;
+        rhs.clear();
+        return *this;
+    }
+
+    /// Get the allocator the list allocates its memory with.
+    ///
+    Allocator& get_allocator() {
+        if constexpr (ALLOC_BY_REF)
+            return *allocator;
+        else
+            return allocator;
     }
 
     /// Trims the amount of allocated memory to
     /// accommodate for the size of the list.
     ///
-    /// NOTE: This has the overhead of having to
-    /// copy the new memory over and free the old.
+    /// NOTE: This may have the overhead of having to
+    /// move the elements over to new memory.
     ///
     void trim() {
-        ulen new_capacity = next_pow_of2(csize);
-        if (new_capacity != capacity) {
-            T* old_buckets = buckets;
-            alloc_buckets(new_capacity);
-            memcpy(buckets, old_buckets, csize*sizeof(T));
-            free_buckets(old_buckets);
+        if (csize == 0) {
+            free_buckets(buckets);
+            buckets  = nullptr;
+            capacity = 0;
+            return;
         }
+        ulen new_capacity = next_pow_of2(csize);
+        if (new_capacity != capacity)
+            realloc_buckets(new_capacity);
     }
 };
+
+/// A list is relocatable so long as its allocator is
+/// since it only refers to its buckets.
+template<typename T, typename Allocator>
+struct IsTriviallyRelocatable<List<T, Allocator>> : std::bool_constant<
+    HOLD_ALLOCATOR_BY_REF<Allocator> || is_trivially_relocatable_v<Allocator>
+> {};
 }
 
+// Included after the definition of List since mem.h relies on List.h
+// and List relies on DynAllocator.
+#include "mem.h"
+
 #endif
@@ -0,0 +1,248 @@
+//===---------------------------------------------------------===
+//
+// A list which keeps its first few elements inline and only
+// allocates once it outgrows them.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_SMALL_LIST_H
+#define SSC_SMALL_LIST_H
+
+#include "List.h"
+
+namespace ssc {
+
+/// A list with the same interface as List which stores up to
+/// `N` elements inside of itself. Operand, predecessor and
+/// parameter lists rarely hold more than a few elements so
+/// this avoids allocating for most of them.
+///
+/// The size and capacity are 32 bits to keep the header to
+/// two words.
+///
+/// NOTE: Unlike List, moving the list moves the elements
+/// when they are stored inline so pointers to elements are
+/// only kept when the elements had spilled to the allocator.
+///
+/// The elements are handled by ListBase like those of List,
+/// SmallList only decides where they are stored.
+///
+template<typename T, u32 N = 4, typename Allocator = DynAllocator>
+class SmallList : public ListBase<SmallList<T, N, Allocator>, T> {
+private:
+    static_assert(N > 0, "use List for lists without inline storage");
+
+    friend class ListBase<SmallList, T>;
+    using Base = ListBase<SmallList, T>;
+    using Base::RELOCATABLE;
+    using Base::destroy_range;
+
+    static constexpr bool ALLOC_BY_REF=HOLD_ALLOCATOR_BY_REF<Allocator>;
+
+    T*  buckets;
+    u32 csize=0;
+    u32 capacity=N;
+
+    [[no_unique_address]]
+    std::conditional_t<ALLOC_BY_REF, Allocator*, Allocator> allocator;
+
+    alignas(T) unsigned char inline_buckets[N * sizeof(T)];
+
+    T* inline_data() {
+        return reinterpret_cast<T*>(inline_buckets);
+    }
+
+    bool is_inline() const {
+        return buckets == reinterpret_cast<const T*>(inline_buckets);
+    }
+
+    void free_buckets() {
+        if (!is_inline())
+            get_allocator().free(buckets);
+    }
+
+      // Moves the elements to new memory with room
+      // for `new_capacity` elements.
+    void realloc_buckets(ulen new_capacity) {
+        if (new_capacity > UINT32_MAX)
+            panic("small list capacity overflow");
+        if (new_capacity <= N) {
+            // Moving the elements back inline.
+            if (is_inline())
+                return;
+            T* old_buckets=buckets;
+            relocate(inline_data(), old_buckets, csize);
+            get_allocator().free(old_buckets);
+            buckets  = inline_data();
+            capacity = N;
+            return;
+        }
+        if constexpr (requires (Allocator& a) { a.try_extend(nullptr, 0, 0); }) {
+            if (!is_inline() && new_capacity > capacity &&
+                get_allocator().try_extend(buckets,
+                                           capacity * sizeof(T),
+                                           new_capacity * sizeof(T))) {
+                capacity = (u32) new_capacity;
+                return;
+            }
+        }
+        if constexpr (RELOCATABLE &&
+                      requires (Allocator& a) { a.realloc(nullptr, 0, 0); }) {
+            if (!is_inline()) {
+                buckets = (T*) get_allocator().realloc(buckets,
+                                                       capacity * sizeof(T),
+                                                       new_capacity * sizeof(T));
+                capacity = (u32) new_capacity;
+                return;
+            }
+        }
+        T* old_buckets=buckets;
+        buckets = (T*) get_allocator().alloc(new_capacity * sizeof(T));
+        relocate(buckets, old_buckets, csize);
+        if (old_buckets != inline_data())
+            get_allocator().free(old_buckets);
+        capacity = (u32) new_capacity;
+    }
+
+      // Whether memory allocated by either list may be
+      // freed by the other.
+    bool same_allocator(const SmallList& rhs) const {
+        if constexpr (ALLOC_BY_REF)
+            return allocator == rhs.allocator;
+        else
+            return std::is_empty_v<Allocator>;
+    }
+
+    static auto get_allocator_storage(Allocator& allocator) {
+        if constexpr (ALLOC_BY_REF)
+            return &allocator;
+        else
+            return allocator;
+    }
+
+      // Initializes the list with copies of the elements. Only
+      // used by constructors.
+    void init_from(const T* elms, ulen count) {
+        reserve(count);
+        std::uninitialized_copy(elms, elms+count, begin());
+        csize = (u32) count;
+    }
+
+      // Takes the elements of `rhs`, which must share the allocator
+      // of this list. Only used on an empty list.
+    void take_from(SmallList& rhs) {
+        if (rhs.is_inline()) {
+            relocate(inline_data(), rhs.begin(), rhs.csize);
+            buckets  = inline_data();
+            capacity = N;
+        } else {
+            buckets  = std::exchange(rhs.buckets, rhs.inline_data());
+            capacity = std::exchange(rhs.capacity, N);
+        }
+        csize = std::exchange(rhs.csize, 0);
+    }
+
+public:
+    using Base::relocate;
+    using Base::begin;
+    using Base::end;
+    using Base::size;
+    using Base::reserve;
+    using Base::clear;
+
+    ~SmallList() {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destroy_range(begin(), end());
+        free_buckets();
+    }
+    SmallList() requires (!ALLOC_BY_REF) :
+        buckets(inline_data())
+    {}
+    explicit SmallList(Allocator& allocator) :
+        buckets(inline_data()),
+        allocator(get_allocator_storage(allocator))
+    {}
+    SmallList(std::initializer_list<T> il) requires (!ALLOC_BY_REF) :
+        buckets(inline_data())
+    {
+        init_from(il.begin(), il.size());
+    }
+    SmallList(std::initializer_list<T> il, Allocator& allocator) :
+        buckets(inline_data()),
+        allocator(get_allocator_storage(allocator))
+    {
+        init_from(il.begin(), il.size());
+    }
+      // copy constructor, the copy uses the same allocator.
+    SmallList(const SmallList& rhs) :
+        Base(),
+        buckets(inline_data()),
+        allocator(rhs.allocator)
+    {
+        init_from(rhs.begin(), rhs.size());
+    }
+      // move constructor
+    SmallList(SmallList&& rhs) noexcept :
+        buckets(inline_data()),
+        allocator(rhs.allocator)
+    {
+        take_from(rhs);
+    }
+      // copy assignment, keeps the allocator of this list.
+    SmallList& operator=(const SmallList& rhs) {
+          // avoid self-assignment.
+        if (this == &rhs) return *this;
+
+        clear();
+        init_from(rhs.begin(), rhs.size());
+        return *this;
+    }
+      // move assignment, keeps the allocator of this list.
+    SmallList& operator=(SmallList&& rhs) noexcept {
+          // Avoid self-assignment.
+        if (this == &rhs) return *this;
+
+        clear();
+        if (!rhs.is_inline() && same_allocator(rhs)) {
+            free_buckets();
+            buckets  = inline_data();
+            capacity = N;
+            take_from(rhs);
+            return *this;
+        }
+
+        reserve(rhs.size());
+        std::uninitialized_move(rhs.begin(), rhs.end(), begin());
+        csize = rhs.csize;
+        rhs.clear();
+        return *this;
+    }
+
+    /// Get the allocator the list allocates its memory with.
+    ///
+    Allocator& get_allocator() {
+        if constexpr (ALLOC_BY_REF)
+            return *allocator;
+        else
+            return allocator;
+    }
+
+    /// Whether the elements no longer fit inline and were
+    /// allocated by the allocator.
+    ///
+    bool spilled() const { return !is_inline(); }
+
+    /// Trims the amount of allocated memory to accommodate
+    /// for the size of the list, moving the elements back
+    /// inline if they fit.
+    ///
+    void trim() {
+        if (is_inline())
+            return;
+        ulen new_capacity = next_pow_of2(csize);
+        if (new_capacity != capacity)
+            realloc_buckets(new_capacity);
+    }
+};
+}
+
+#endif
@@ -0,0 +1,345 @@
+//===---------------------------------------------------------===
+//
+// A list of records which stores each field of the records in
+// its own array.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_SOA_LIST_H
+#define SSC_SOA_LIST_H
+
+#include "List.h"
+
+#include <tuple>
+#include <span>
+#include <cstddef> // for std::max_align_t, std::ptrdiff_t
+
+namespace ssc {
+
+/// A list of records with the fields `Fields...` where each
+/// field is kept in a contiguous column instead of keeping
+/// each record together. Loops which only read some of the
+/// fields, such as scanning tokens by kind, only touch the
+/// memory of those fields and can be vectorized over a column.
+///
+/// All the columns share one allocation and the size and
+/// capacity of the list.
+///
+/// Fields are accessed by their index:
+///
+///     SoAList<TokenKind, u32> tokens;
+///     tokens.add(TokenKind::Ident, 10);
+///     for (TokenKind kind : tokens.column<0>()) ...
+///     for (auto [kind, offset] : tokens) ...
+///     auto [kind, offset] = tokens[0];
+///
+/// The allocator comes first since the fields are a pack,
+/// SoAList is the list using DynAllocator.
+///
+template<typename Allocator, typename... Fields>
+class BasicSoAList {
+private:
+    static_assert(sizeof...(Fields) > 0, "a list needs at least one field");
+    static_assert(((alignof(Fields) <= alignof(std::max_align_t)) && ...),
+                  "fields cannot be over-aligned");
+
+    static constexpr bool ALLOC_BY_REF=HOLD_ALLOCATOR_BY_REF<Allocator>;
+    static constexpr ulen FIELD_COUNT=sizeof...(Fields);
+      // Columns start on a 16 byte boundary so whole vectors
+      // can be loaded from the start of each column.
+    static constexpr ulen COLUMN_ALIGN=alignof(std::max_align_t) > 16 ?
+                                       alignof(std::max_align_t) : 16;
+
+    template<ulen I>
+    using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    ulen capacity=0;
+    ulen csize=0;
+    std::tuple<Fields*...> columns;
+
+    [[no_unique_address]]
+    std::conditional_t<ALLOC_BY_REF, Allocator*, Allocator> allocator;
+
+    static ulen align_column(ulen offset) {
+        return (offset + COLUMN_ALIGN-1) & ~(COLUMN_ALIGN-1);
+    }
+
+      // Lays out the columns one after the other in
+      // a single block of memory.
+    static ulen block_size(ulen capacity) {
+        ulen size=0;
+        ((size = align_column(size + capacity * sizeof(Fields))), ...);
+        return size;
+    }
+
+    static auto get_allocator_storage(Allocator& allocator) {
+        if constexpr (ALLOC_BY_REF)
+            return &allocator;
+        else
+            return allocator;
+    }
+
+      // Whether memory allocated by either list may be
+      // freed by the other.
+    bool same_allocator(const BasicSoAList& rhs) const {
+        if constexpr (ALLOC_BY_REF)
+            return allocator == rhs.allocator;
+        else
+            return std::is_empty_v<Allocator>;
+    }
+
+    void free_columns() {
+        // The first column is at the start of the block.
+        if (std::get<0>(columns))
+            get_allocator().free(std::get<0>(columns));
+    }
+
+    template<ulen... Is>
+    void realloc_columns(ulen new_capacity, std::index_sequence<Is...>) {
+        char* block = (char*) get_allocator().alloc(block_size(new_capacity));
+        ulen offset = 0;
+        std::tuple<Fields*...> new_columns;
+        ((std::get<Is>(new_columns) = (Field<Is>*) (block + offset),
+          offset = align_column(offset + new_capacity * sizeof(Field<Is>))), ...);
+        (List<Field<Is>>::relocate(std::get<Is>(new_columns), std::get<Is>(columns), csize), ...);
+
+        free_columns();
+        columns  = new_columns;
+        capacity = new_capacity;
+    }
+
+    void grow() {
+        reserve(capacity == 0 ? 16 : capacity << 1);
+    }
+
+    template<ulen... Is>
+    void destroy_rows(ulen from, ulen to, std::index_sequence<Is...>) {
+        auto destroy = [&]<typename T>(T* column) {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                for (ulen i=from; i < to; ++i)
+                    column[i].~T();
+        };
+        (destroy(std::get<Is>(columns)), ...);
+    }
+
+    template<ulen... Is, typename... Args>
+    void construct_row(ulen idx, std::index_sequence<Is...>, Args&&... args) {
+        (::new (std::get<Is>(columns) + idx) Field<Is>(std::forward<Args>(args)), ...);
+    }
+
+    template<ulen... Is>
+    void construct_default_row(ulen idx, std::index_sequence<Is...>) {
+        (::new (std::get<Is>(columns) + idx) Field<Is>(), ...);
+    }
+
+    template<typename R, ulen... Is>
+    R row(ulen idx, std::index_sequence<Is...>) const {
+        return R(std::get<Is>(columns)[idx]...);
+    }
+
+    template<ulen... Is>
+    void move_rows_from(BasicSoAList& rhs, std::index_sequence<Is...>) {
+        (std::uninitialized_move(std::get<Is>(rhs.columns),
+                                 std::get<Is>(rhs.columns) + rhs.csize,
+                                 std::get<Is>(columns)), ...);
+    }
+
+public:
+    /// The fields of a single record, refering to
+    /// the elements of each column.
+    ///
+    using Row      = std::tuple<Fields&...>;
+    using ConstRow = std::tuple<const Fields&...>;
+
+    /// Iterates over the records of the list yielding
+    /// a row for each of them.
+    ///
+    template<typename L, typename R>
+    class RowIterator {
+    public:
+        using value_type        = R;
+        using reference         = R;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        RowIterator() = default;
+        RowIterator(L* list, ulen idx) :
+            list(list),
+            idx(idx)
+        {}
+
+        R operator*() const { return (*list)[idx]; }
+
+        RowIterator& operator++() {
+            ++idx;
+            return *this;
+        }
+        RowIterator operator++(int) {
+            RowIterator prev=*this;
+            ++idx;
+            return prev;
+        }
+
+        bool operator==(const RowIterator& rhs) const { return idx == rhs.idx; }
+
+    private:
+        L*   list=nullptr;
+        ulen idx=0;
+    };
+
+    using Iterator      = RowIterator<BasicSoAList, Row>;
+    using ConstIterator = RowIterator<const BasicSoAList, ConstRow>;
+
+    ~BasicSoAList() {
+        destroy_rows(0, csize, std::index_sequence_for<Fields...>());
+        free_columns();
+    }
+    BasicSoAList() requires (!ALLOC_BY_REF) = default;
+    explicit BasicSoAList(Allocator& allocator) :
+        allocator(get_allocator_storage(allocator))
+    {}
+      // The columns are filled with the fields of the records
+      // so copying would be too easy to do by mistake.
+    BasicSoAList(const BasicSoAList&) = delete;
+    BasicSoAList& operator=(const BasicSoAList&) = delete;
+      // move constructor
+    BasicSoAList(BasicSoAList&& rhs) noexcept :
+        capacity(std::exchange(rhs.capacity, 0)),
+        csize(std::exchange(rhs.csize, 0)),
+        columns(std::exchange(rhs.columns, {})),
+        allocator(rhs.allocator)
+    {}
+      // move assignment, keeps the allocator of this list.
+    BasicSoAList& operator=(BasicSoAList&& rhs) noexcept {
+        if (this == &rhs) return *this;
+        clear();
+
+        if (!same_allocator(rhs)) {
+            // The records are moved into memory of
+            // this list's allocator.
+            reserve(rhs.csize);
+            move_rows_from(rhs, std::index_sequence_for<Fields...>());
+            csize = rhs.csize;
+            rhs.clear();
+            return *this;
+        }
+
+        free_columns();
+        capacity = std::exchange(rhs.capacity, 0);
+        csize    = std::exchange(rhs.csize, 0);
+        columns  = std::exchange(rhs.columns, {});
+        return *this;
+    }
+
+    /// Get the allocator the list allocates its memory with.
+    ///
+    Allocator& get_allocator() {
+        if constexpr (ALLOC_BY_REF)
+            return *allocator;
+        else
+            return allocator;
+    }
+
+    /// Get the number of records in this list.
+    ///
+    ulen size() const { return csize; }
+
+    /// Whether the list has no records.
+    ///
+    bool empty() const { return csize == 0; }
+
+    /// Get every element of the field at index `I`.
+    ///
+    template<ulen I>
+    std::span<Field<I>> column() {
+        return std::span<Field<I>>(std::get<I>(columns), csize);
+    }
+    template<ulen I>
+    std::span<const Field<I>> column() const {
+        return std::span<const Field<I>>(std::get<I>(columns), csize);
+    }
+
+    /// Get the field at index `I` of a record.
+    ///
+    template<ulen I>
+    Field<I>& get(ulen idx) {
+        DBG_ASSERT(idx < csize, "soa list out of bounds");
+        return std::get<I>(columns)[idx];
+    }
+    template<ulen I>
+    const Field<I>& get(ulen idx) const {
+        DBG_ASSERT(idx < csize, "soa list out of bounds");
+        return std::get<I>(columns)[idx];
+    }
+
+    /// Get all the fields of a record.
+    ///
+    Row operator[](ulen idx) {
+        DBG_ASSERT(idx < csize, "soa list out of bounds");
+        return row<Row>(idx, std::index_sequence_for<Fields...>());
+    }
+    ConstRow operator[](ulen idx) const {
+        DBG_ASSERT(idx < csize, "soa list out of bounds");
+        return row<ConstRow>(idx, std::index_sequence_for<Fields...>());
+    }
+
+    Iterator begin() { return Iterator(this, 0); }
+    Iterator end() { return Iterator(this, csize); }
+    ConstIterator begin() const { return ConstIterator(this, 0); }
+    ConstIterator end() const { return ConstIterator(this, csize); }
+
+    /// Append a record to the end of the list constructing
+    /// each field from the matching argument.
+    ///
+    /// \return the index of the record.
+    ///
+    template<typename... Args>
+    ulen add(Args&&... args) {
+        static_assert(sizeof...(Args) == FIELD_COUNT,
+                      "a record needs a value for every field");
+        if (csize == capacity) grow();
+        construct_row(csize, std::index_sequence_for<Fields...>(),
+                      std::forward<Args>(args)...);
+        return csize++;
+    }
+
+    /// Removes the last record of the list.
+    ///
+    void pop_back() {
+        DBG_ASSERT(!empty(), "cannot pop an empty list");
+        destroy_rows(csize-1, csize, std::index_sequence_for<Fields...>());
+        --csize;
+    }
+
+    /// Reserves memory for at least `size` records.
+    ///
+    void reserve(ulen size) {
+        if (capacity < size)
+            realloc_columns(next_pow_of2(size), std::index_sequence_for<Fields...>());
+    }
+
+    /// Reserves memory and changes the number of records,
+    /// new records have default constructed fields.
+    ///
+    void resize(ulen size) {
+        reserve(size);
+        for (ulen i=csize; i < size; ++i)
+            construct_default_row(i, std::index_sequence_for<Fields...>());
+        if (size < csize)
+            destroy_rows(size, csize, std::index_sequence_for<Fields...>());
+        csize = size;
+    }
+
+    /// Empties the list of all the records but does not
+    /// modify the amount of memory allocated.
+    ///
+    void clear() {
+        destroy_rows(0, csize, std::index_sequence_for<Fields...>());
+        csize = 0;
+    }
+};
+
+template<typename... Fields>
+using SoAList = BasicSoAList<DynAllocator, Fields...>;
+}
+
+#endif
@@ -0,0 +1,68 @@
+//===---------------------------------------------------------===
+//
+// A view of a string which carries its length.
+//
+//===---------------------------------------------------------===
+#ifndef SSC_STR_SLICE_H
+#define SSC_STR_SLICE_H
+
+#include <cstring>     // for strlen, memcmp
+#include <string>
+#include <string_view>
+#include "core_types.h"
+#include "Hash.h"
+
+namespace ssc {
+
+/// Refers to characters owned by something else, such as an
+/// interner or a source file, along with their count so they
+/// never have to be scanned for a terminator. The characters
+/// are not necessarily null terminated.
+///
+class StrSlice {
+public:
+    constexpr StrSlice() : ptr(""), len(0) {}
+    constexpr StrSlice(const char* ptr, ulen len) : ptr(ptr), len(len) {}
+    StrSlice(const char* str) : ptr(str), len(strlen(str)) {}
+    StrSlice(const std::string& str) : ptr(str.data()), len(str.size()) {}
+    constexpr StrSlice(std::string_view str) : ptr(str.data()), len(str.size()) {}
+
+    constexpr const char* data() const { return ptr; }
+    constexpr ulen size() const { return len; }
+    constexpr bool empty() const { return len == 0; }
+
+    constexpr const char* begin() const { return ptr; }
+    constexpr const char* end() const { return ptr + len; }
+
+    constexpr char operator[](ulen idx) const { return ptr[idx]; }
+
+    /// Get the characters from `start` up to, but not
+    /// including, `stop`.
+    ///
+    constexpr StrSlice slice(ulen start, ulen stop) const {
+        return StrSlice(ptr + start, stop - start);
+    }
+
+    constexpr operator std::string_view() const { return std::string_view(ptr, len); }
+
+    std::string to_string() const { return std::string(ptr, len); }
+
+    bool operator==(const StrSlice& rhs) const {
+        return len == rhs.len && memcmp(ptr, rhs.ptr, len) == 0;
+    }
+    bool operator!=(const StrSlice& rhs) const = default;
+
+private:
+    const char* ptr;
+    ulen        len;
+};
+
+template<>
+struct Hash<StrSlice> {
+    u64 operator()(StrSlice s) const {
+        return hash_bytes(s.data(), s.size());
+    }
+};
+}
+
+#endif